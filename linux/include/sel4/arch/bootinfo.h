@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2015, Josef Mihalits
+ *
+ * This software may be distributed and modified according to the terms of
+ * the GNU General Public License version 2. Note that NO WARRANTY is provided.
+ * See "COPYING" for details.
+ *
+ */
+
+/*
+ * Stand-in for the kernel header of the same name when building for Linux
+ * (see linux/Makefile): only the VBE mode info block is needed. The layout
+ * follows the VBE 3.0 ModeInfoBlock, like the kernel's.
+ */
+
+#ifndef SEL4DOOM_LINUX_BOOTINFO_H_
+#define SEL4DOOM_LINUX_BOOTINFO_H_
+
+#include <stdint.h>
+
+typedef struct seL4_VBEModeInfoBlock {
+    /* all revisions */
+    uint16_t modeAttr;
+    uint8_t  winAAttr;
+    uint8_t  winBAttr;
+    uint16_t winGranularity;
+    uint16_t winSize;
+    uint16_t winASeg;
+    uint16_t winBSeg;
+    uint32_t winFuncPtr;
+    uint16_t bytesPerScanLine;
+
+    /* 1.2+ */
+    uint16_t xRes;
+    uint16_t yRes;
+    uint8_t  xCharSize;
+    uint8_t  yCharSize;
+    uint8_t  planes;
+    uint8_t  bitsPerPixel;
+    uint8_t  banks;
+    uint8_t  memoryModel;
+    uint8_t  bankSize;
+    uint8_t  imagePages;
+    uint8_t  reserved1;
+
+    uint8_t  redLen;
+    uint8_t  redOff;
+    uint8_t  greenLen;
+    uint8_t  greenOff;
+    uint8_t  blueLen;
+    uint8_t  blueOff;
+    uint8_t  rsvdLen;
+    uint8_t  rsvdOff;
+    uint8_t  directColorInfo;
+
+    /* 2.0+ */
+    uint32_t physBasePtr;
+    uint8_t  reserved2[6];
+
+    /* 3.0+ */
+    uint16_t linBytesPerScanLine;
+    uint8_t  bnkImagePages;
+    uint8_t  linImagePages;
+    uint8_t  linRedLen;
+    uint8_t  linRedOff;
+    uint8_t  linGreenLen;
+    uint8_t  linGreenOff;
+    uint8_t  linBlueLen;
+    uint8_t  linBlueOff;
+    uint8_t  linRsvdLen;
+    uint8_t  linRsvdOff;
+    uint32_t maxPixelClock;
+    uint16_t modeId;
+    uint8_t  depth;
+
+    uint8_t  reserved3[187];
+} __attribute__((packed)) seL4_VBEModeInfoBlock;
+
+#endif /* SEL4DOOM_LINUX_BOOTINFO_H_ */
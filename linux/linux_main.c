@@ -0,0 +1,377 @@
+/*
+ * Copyright (c) 2015, Josef Mihalits
+ *
+ * This software may be distributed and modified according to the terms of
+ * the GNU General Public License version 2. Note that NO WARRANTY is provided.
+ * See "COPYING" for details.
+ *
+ */
+
+/*
+ * Linux implementation of the platform interface in src/sel4_doom.h; it
+ * takes the place of src/sel4_main.c when building with linux/Makefile.
+ * This way the game can run under perf, valgrind, and the sanitizers
+ * without booting seL4.
+ *
+ *  - The frame buffer is plain memory; send SIGUSR1 to the process to
+ *    have the current frame written to doomNNN.ppm.
+ *  - "-hostres WxH" sets the size of the frame buffer (default 640x400).
+ *  - Files are read from disk (with DATADIR as fallback for the logos).
+ *  - Key presses are read from stdin if it is a terminal. Terminals do not
+ *    report key releases, so every key is released on the next poll.
+ *  - Render threads (RENDER_THREADS=y) and the present thread (-pipeline)
+ *    are pthreads.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include "sel4_doom.h"
+#include "sel4.local/libplatsupport/keyboard_vkey.h"
+
+int main_ORIGINAL(int argc, char** argv);
+
+/* frame buffer and its mode info */
+static uint32_t* fb = NULL;
+static seL4_VBEModeInfoBlock vbe;
+
+/* time of program start */
+static struct timespec starttime;
+
+/* set by SIGUSR1; the frame is written out on the next key poll */
+static volatile sig_atomic_t dump_requested = 0;
+static int dump_count = 0;
+
+/* terminal state to restore on exit; valid if use_terminal is set */
+static struct termios saved_termios;
+static int use_terminal = 0;
+
+/* key to release on the next poll, -1 if none */
+static int16_t pending_release = -1;
+
+
+/*
+ *  @return: time since start (in ns)
+ */
+uint64_t
+sel4doom_get_current_time_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) (now.tv_sec - starttime.tv_sec) * 1000000000
+            + now.tv_nsec - starttime.tv_nsec;
+}
+
+
+/*
+ *  @return: time since start (in ms)
+ */
+uint32_t
+sel4doom_get_current_time() {
+    return sel4doom_get_current_time_ns() / 1000000;
+}
+
+
+/*
+ * @return: base address of frame buffer
+ */
+void *
+sel4doom_get_framebuffer_vaddr() {
+    return fb;
+}
+
+
+/*
+ * Make VBE mode info available.
+ */
+void
+sel4doom_get_vbe(seL4_VBEModeInfoBlock* mib) {
+    *mib = vbe;
+}
+
+
+static void *
+read_file(const char* filename, unsigned long* size) {
+    FILE* f = fopen(filename, "rb");
+    if (f == NULL) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long filesize = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    /* zero terminated for the benefit of sscanf users */
+    char* data = malloc(filesize + 1);
+    if (data == NULL || fread(data, 1, filesize, f) != filesize) {
+        fclose(f);
+        free(data);
+        return NULL;
+    }
+    fclose(f);
+    data[filesize] = '\0';
+    if (size != NULL) {
+        *size = filesize;
+    }
+    return data;
+}
+
+
+/*
+ * Reads the whole file into memory. Like the cpio archive on seL4, the
+ * memory is never freed.
+ */
+void*
+sel4doom_load_file(const char* filename, unsigned long* size) {
+    void* data = read_file(filename, size);
+#ifdef DATADIR
+    if (data == NULL && strchr(filename, '/') == NULL) {
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/%s", DATADIR, filename);
+        data = read_file(path, size);
+    }
+#endif
+    return data;
+}
+
+
+static void
+dump_ppm() {
+    char filename[20];
+    snprintf(filename, sizeof(filename), "doom%03d.ppm", dump_count++);
+    FILE* f = fopen(filename, "wb");
+    if (f == NULL) {
+        printf("could not write %s\n", filename);
+        return;
+    }
+    fprintf(f, "P6\n%d %d\n255\n", vbe.xRes, vbe.yRes);
+    for (int i = 0; i < vbe.xRes * vbe.yRes; i++) {
+        putc(fb[i] >> vbe.linRedOff, f);
+        putc(fb[i] >> vbe.linGreenOff, f);
+        putc(fb[i] >> vbe.linBlueOff, f);
+    }
+    fclose(f);
+    printf("frame written to %s\n", filename);
+}
+
+
+static void
+handle_sigusr1(int sig) {
+    dump_requested = 1;
+}
+
+
+/*
+ * Maps a character read from the terminal to a virtual key code.
+ *  @return: vkey, or -1 if the character has no key
+ */
+static int16_t
+char_to_vkey(int c) {
+    if (isalpha(c)) {
+        return toupper(c);
+    }
+    if (isdigit(c) || c == ' ') {
+        return c;
+    }
+    switch (c) {
+    case '\r':
+    case '\n':
+        return VK_RETURN;
+    case '\t':
+        return VK_TAB;
+    case 8:
+    case 127:
+        return VK_BACK;
+    case ',':
+        return VK_OEM_COMMA;
+    case '.':
+        return VK_OEM_PERIOD;
+    case '-':
+        return VK_OEM_MINUS;
+    case '=':
+    case '+':
+        return VK_OEM_PLUS;
+    case 27:
+        /* ESC alone, or the start of an arrow key sequence */
+        if (getchar() != '[') {
+            return VK_ESCAPE;
+        }
+        switch (getchar()) {
+        case 'A':
+            return VK_UP;
+        case 'B':
+            return VK_DOWN;
+        case 'C':
+            return VK_RIGHT;
+        case 'D':
+            return VK_LEFT;
+        }
+        return -1;
+    }
+    return -1;
+}
+
+
+int
+sel4doom_keyboard_poll_keyevent(int16_t* vkey) {
+    if (dump_requested) {
+        dump_requested = 0;
+        dump_ppm();
+    }
+
+    if (pending_release != -1) {
+        *vkey = pending_release;
+        pending_release = -1;
+        return 0;
+    }
+
+    *vkey = -1;
+    if (!use_terminal) {
+        return 0;
+    }
+    int c;
+    while ((c = getchar()) != EOF) {
+        int16_t k = char_to_vkey(c);
+        if (k != -1) {
+            *vkey = pending_release = k;
+            return 1;
+        }
+    }
+    clearerr(stdin);
+    return 0;
+}
+
+
+typedef struct {
+    void (*entry)(void* arg);
+    void* arg;
+} thread_start_t;
+
+
+static void *
+thread_main(void* start) {
+    thread_start_t s = *(thread_start_t*) start;
+    free(start);
+    s.entry(s.arg);
+    return NULL;
+}
+
+
+int
+sel4doom_thread_create(void (*entry)(void* arg), void* arg) {
+    pthread_t thread;
+    thread_start_t* start = malloc(sizeof(*start));
+    if (start == NULL) {
+        return -1;
+    }
+    start->entry = entry;
+    start->arg = arg;
+    if (pthread_create(&thread, NULL, thread_main, start)) {
+        free(start);
+        return -1;
+    }
+    pthread_detach(thread);
+    return 0;
+}
+
+
+void*
+sel4doom_sem_create(int value) {
+    sem_t* sem = malloc(sizeof(*sem));
+    if (sem != NULL && sem_init(sem, 0, value)) {
+        free(sem);
+        return NULL;
+    }
+    return sem;
+}
+
+
+void
+sel4doom_sem_wait(void* sem) {
+    while (sem_wait(sem) && errno == EINTR) {
+        /* interrupted by SIGUSR1 */
+    }
+}
+
+
+void
+sel4doom_sem_post(void* sem) {
+    sem_post(sem);
+}
+
+
+static void
+restore_terminal() {
+    tcsetattr(STDIN_FILENO, TCSANOW, &saved_termios);
+}
+
+
+/*
+ * Switch the terminal to non-canonical, non-blocking input without echo.
+ */
+static void
+init_terminal() {
+    if (!isatty(STDIN_FILENO) || tcgetattr(STDIN_FILENO, &saved_termios)) {
+        return;
+    }
+    struct termios raw = saved_termios;
+    raw.c_lflag &= ~(ICANON | ECHO);
+    raw.c_cc[VMIN] = 0;
+    raw.c_cc[VTIME] = 0;
+    tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+    fcntl(STDIN_FILENO, F_SETFL, fcntl(STDIN_FILENO, F_GETFL) | O_NONBLOCK);
+    atexit(restore_terminal);
+    use_terminal = 1;
+}
+
+
+static void
+init_framebuffer(int argc, char** argv) {
+    int xres = 640;
+    int yres = 400;
+    for (int i = 1; i < argc - 1; i++) {
+        if (strcmp(argv[i], "-hostres") == 0
+        && sscanf(argv[i + 1], "%dx%d", &xres, &yres) != 2) {
+            printf("-hostres: expected WIDTHxHEIGHT\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (xres < 320 || yres < 200 || xres > 0xffff / 4 || yres > 0xffff) {
+        printf("Error: frame buffer must be at least 320x200\n");
+        exit(EXIT_FAILURE);
+    }
+
+    memset(&vbe, 0, sizeof(vbe));
+    vbe.xRes = xres;
+    vbe.yRes = yres;
+    vbe.bitsPerPixel = 32;
+    vbe.linBytesPerScanLine = xres * 4;
+    vbe.linRedLen = vbe.linGreenLen = vbe.linBlueLen = 8;
+    vbe.linRedOff = 16;
+    vbe.linGreenOff = 8;
+    vbe.linBlueOff = 0;
+
+    fb = calloc(xres * yres, sizeof(uint32_t));
+    if (fb == NULL) {
+        printf("Error: could not allocate frame buffer\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+
+int
+main(int argc, char** argv) {
+    clock_gettime(CLOCK_MONOTONIC, &starttime);
+    init_framebuffer(argc, argv);
+    init_terminal();
+    signal(SIGUSR1, handle_sigusr1);
+
+    /* we never return */
+    return main_ORIGINAL(argc, argv);
+}
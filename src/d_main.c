@@ -85,6 +85,9 @@ static int access(char *file, int mode)
 #include "p_setup.h"
 #include "r_local.h"
 
+#include "m_prof.h"
+#include "m_bench.h"
+
 
 #include "d_main.h"
 
@@ -231,7 +234,8 @@ void D_Display (void)
     }
 
     // save the current screen if about to wipe
-    if (gamestate != wipegamestate)
+    // wipes run in real time, which would only skew benchmark results
+    if (gamestate != wipegamestate && !benchmarking)
     {
 	wipe = true;
 	wipe_StartScreen(0, 0, SCREENWIDTH, SCREENHEIGHT);
@@ -250,12 +254,14 @@ void D_Display (void)
 	    break;
 	if (automapactive)
 	    AM_Drawer ();
-	if (wipe || (viewheight != 200 && fullscreen) )
+	if (wipe || (viewheight != SCREENHEIGHT && fullscreen) )
 	    redrawsbar = true;
 	if (inhelpscreensstate && !inhelpscreens)
 	    redrawsbar = true;              // just put away the help screen
-	ST_Drawer (viewheight == 200, redrawsbar );
-	fullscreen = viewheight == 200;
+	PROF_START (prof_stbar);
+	ST_Drawer (viewheight == SCREENHEIGHT, redrawsbar );
+	PROF_STOP (prof_stbar);
+	fullscreen = viewheight == SCREENHEIGHT;
 	break;
 
       case GS_INTERMISSION:
@@ -276,7 +282,10 @@ void D_Display (void)
     
     // draw the view directly
     if (gamestate == GS_LEVEL && !automapactive && gametic)
+    {
 	R_RenderPlayerView (&players[displayplayer]);
+	V_MarkRect (viewwindowx, viewwindowy, scaledviewwidth, viewheight);
+    }
 
     if (gamestate == GS_LEVEL && gametic)
 	HU_Drawer ();
@@ -293,7 +302,7 @@ void D_Display (void)
     }
 
     // see if the border needs to be updated to the screen
-    if (gamestate == GS_LEVEL && !automapactive && scaledviewwidth != 320)
+    if (gamestate == GS_LEVEL && !automapactive && scaledviewwidth != SCREENWIDTH)
     {
 	if (menuactive || menuactivestate || !viewactivestate)
 	    borderdrawcount = 3;
@@ -316,12 +325,16 @@ void D_Display (void)
 	if (automapactive)
 	    y = 4;
 	else
-	    y = viewwindowy+4;
-	V_DrawPatchDirect(viewwindowx+(scaledviewwidth-68)/2,
+	    y = (viewwindowy>>hires)+4;
+	V_DrawPatchDirect(((viewwindowx+scaledviewwidth/2)>>hires)-34,
 			  y,0,W_CacheLumpName ("M_PAUSE", PU_CACHE));
     }
 
 
+    // frame profiler overlay
+    if (gamestate == GS_LEVEL && !automapactive && gametic && !benchmarking)
+	M_ProfileDrawer ();
+
     // menus go directly to the screen
     M_Drawer ();          // menu is drawn even on top of everything
     NetUpdate ();         // send out any new accumulation
@@ -330,7 +343,11 @@ void D_Display (void)
     // normal update
     if (!wipe)
     {
+	if (noblit)
+	    return;                     // for comparative timing purposes
+	PROF_START (prof_blit);
 	I_FinishUpdate ();              // page flip or blit buffer
+	PROF_STOP (prof_blit);
 	return;
     }
     
@@ -347,11 +364,14 @@ void D_Display (void)
 	    tics = nowtime - wipestart;
 	} while (!tics);
 	wipestart = nowtime;
+	// the melt moves in pixels, so scale it with the screen
 	done = wipe_ScreenWipe(wipe_Melt
-			       , 0, 0, SCREENWIDTH, SCREENHEIGHT, tics);
+			       , 0, 0, SCREENWIDTH, SCREENHEIGHT, tics<<hires);
 	I_UpdateNoBlit ();
 	M_Drawer ();                            // menu is drawn even on top of wipes
+	PROF_START (prof_blit);
 	I_FinishUpdate ();                      // page flip or blit buffer
+	PROF_STOP (prof_blit);
     } while (!done);
 }
 
@@ -400,10 +420,13 @@ void D_DoomLoop (void)
 	    TryRunTics (); // will run at least one tic
 	}
 
+	PROF_START (prof_sound);
 	S_UpdateSounds (players[consoleplayer].mo);// move positional sounds
+	PROF_STOP (prof_sound);
 
 	// Update display, next frame, with current state.
 	D_Display ();
+	M_ProfileFrame ();
     }
 }
 
@@ -948,6 +971,17 @@ void D_DoomMain (void)
 	D_AddFile (file);
 	printf("Playing demo %s.lmp.\n",myargv[p+1]);
     }
+
+    p = M_CheckParm ("-benchmark");
+    if (p)
+    {
+	// demos are lump names or .lmp files
+	while (++p != myargc && myargv[p][0] != '-')
+	{
+	    sprintf (file,"%s.lmp", myargv[p]);
+	    D_AddFile (file);
+	}
+    }
     
     // get skill / episode / map from parms
     startskill = sk_medium;
@@ -1082,6 +1116,7 @@ printf("added\n");
 
     printf ("M_Init: Init miscellaneous info.\n");
     M_Init ();
+    M_ProfileInit ();
 
     printf ("R_Init: Init DOOM refresh daemon - ");
     R_Init ();
@@ -1104,6 +1139,9 @@ printf("added\n");
     printf ("ST_Init: Init status bar.\n");
     ST_Init ();
 
+    if (M_CheckParm ("-wadstats"))
+	W_PrintLookupStats ();
+
     // check for a driver that wants intermission stats
     p = M_CheckParm ("-statcopy");
     if (p && p<myargc-1)
@@ -1138,6 +1176,12 @@ printf("added\n");
 	G_TimeDemo (myargv[p+1]);
 	D_DoomLoop ();  // never returns
     }
+
+    if (M_CheckParm ("-benchmark"))
+    {
+	G_TimeDemo (M_BenchInit ());
+	D_DoomLoop ();  // never returns
+    }
 	
     p = M_CheckParm ("-loadgame");
     if (p && p < myargc-1)
@@ -107,10 +107,24 @@ typedef enum
 // Defines suck. C sucks.
 // C++ might sucks for OOP, but it sure is a better C.
 // So there.
-#define SCREENWIDTH  320
-//SCREEN_MUL*BASE_WIDTH //320
-#define SCREENHEIGHT 200
-//(int)(SCREEN_MUL*BASE_WIDTH*INV_ASPECT_RATIO) //200
+//
+// The screen is ORIGWIDTH x ORIGHEIGHT scaled by 1<<hires, where
+//  hires is set by -hires at startup (see V_Init) and never changes
+//  afterwards. The status bar, menus, etc. are laid out in
+//  ORIGWIDTH x ORIGHEIGHT coordinates and scaled up by the V_ functions.
+// Static arrays indexed by screen position use the MAX sizes.
+//
+#define ORIGWIDTH	320
+#define ORIGHEIGHT	200
+
+#define MAXHIRES	2
+#define MAXSCREENWIDTH	(ORIGWIDTH<<MAXHIRES)
+#define MAXSCREENHEIGHT	(ORIGHEIGHT<<MAXHIRES)
+
+extern int hires;
+
+#define SCREENWIDTH	(ORIGWIDTH<<hires)
+#define SCREENHEIGHT	(ORIGHEIGHT<<hires)
 
 
 
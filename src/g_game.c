@@ -36,6 +36,7 @@ rcsid[] = "$Id: g_game.c,v 1.8 1997/02/03 22:45:09 b1 Exp $";
 #include "m_misc.h"
 #include "m_menu.h"
 #include "m_random.h"
+#include "m_bench.h"
 #include "i_system.h"
 
 #include "p_setup.h"
@@ -69,6 +70,7 @@ rcsid[] = "$Id: g_game.c,v 1.8 1997/02/03 22:45:09 b1 Exp $";
 
 
 #include "g_game.h"
+#include "m_prof.h"
 
 
 #define SAVEGAMESIZE	0x2c000
@@ -727,7 +729,9 @@ void G_Ticker (void)
     switch (gamestate) 
     { 
       case GS_LEVEL: 
+	PROF_START (prof_ticker);
 	P_Ticker (); 
+	PROF_STOP (prof_ticker);
 	ST_Ticker (); 
 	AM_Ticker (); 
 	HU_Ticker ();            
@@ -1617,6 +1621,9 @@ void G_DoPlayDemo (void)
 
     usergame = false; 
     demoplayback = true; 
+
+    if (benchmarking)
+	M_BenchStart ();
 } 
 
 //
@@ -1648,7 +1655,7 @@ boolean G_CheckDemoStatus (void)
 { 
     int             endtime; 
 	 
-    if (timingdemo) 
+    if (timingdemo && !benchmarking) 
     { 
 	endtime = I_GetTime (); 
 	I_Error ("timed %i gametics in %i realtics",gametic 
@@ -1670,7 +1677,10 @@ boolean G_CheckDemoStatus (void)
 	fastparm = false;
 	nomonsters = false;
 	consoleplayer = 0;
-	D_AdvanceDemo (); 
+	if (benchmarking)
+	    G_DeferedPlayDemo (M_BenchNext ());
+	else
+	    D_AdvanceDemo (); 
 	return true; 
     } 
  
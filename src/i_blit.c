@@ -0,0 +1,648 @@
+/*
+ * Copyright (c) 2015, Josef Mihalits
+ *
+ * This software may be distributed and modified according to the terms of
+ * the GNU General Public License version 2. Note that NO WARRANTY is provided.
+ * See "COPYING" for details.
+ *
+ */
+
+/*
+ * Palette expansion: copy the 8-bit screens[0] into the 32bpp frame buffer.
+ *
+ * There is one plain C blitter that runs everywhere and, on x86, an SSE2 and
+ * an AVX2 version. The SIMD versions are compiled with function specific
+ * target attributes, so the rest of the program does not need to be built
+ * with -msse2 or -mavx2; I_SelectBlitter() asks CPUID which one is safe to
+ * use on the machine we are running on.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__i386__) || defined(__x86_64__)
+#define BLIT_X86
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+#include "doomdef.h"
+#include "i_system.h"
+#include "i_blit.h"
+#include "sel4_doom.h"
+
+
+/*
+ * Plain C blitter. We read four source pixels at a time and write them out
+ * one 32 bit store per destination pixel.
+ */
+static void
+I_BlitScalar (uint32_t* fb, int pitch, const byte* screen,
+        const uint32_t* colors, int multiply, int width, int height)
+{
+    /* The number of pixels to skip at the end of a row (i.e. the area right
+     * of the rectangle) plus the pixel rows that were already filled by
+     * the vertical replication of the current row. */
+    const int row_offset = multiply * (pitch - width);
+    /* the same for the source, in units of four pixels */
+    const int src_offset = (SCREENWIDTH - width) / 4;
+    const unsigned int *src = (const unsigned int *) screen;
+
+    if (multiply == 1)
+    {
+        uint32_t *dst = fb;
+        for (int y = height; y; y--) {
+            for (int x = width; x; x -= 4) {
+                /* We process four pixels per iteration. */
+                unsigned int fourpix = *src++;
+
+                //first "src" pixel
+                *dst++ = colors[fourpix & 0xff];
+                //second "src" pixel
+                *dst++ = colors[(fourpix >> 8) & 0xff];
+                //third "src" pixel
+                *dst++ = colors[(fourpix >> 16) & 0xff];
+                //fourth "src" pixel
+                *dst++ = colors[fourpix >> 24];
+            }
+            dst += row_offset;
+            src += src_offset;
+        }
+        return;
+    }
+    if (multiply == 2)
+    {
+        /*indices into frame buffer, one per row */
+        int dst[2] = {0, pitch};
+
+        for (int y = height; y; y--) {
+            for (int x = width; x; x -= 4) {
+                /* We process four "src" pixels per iteration
+                 * and for every source pixel, we write out 4 pixels to "dst".
+                 */
+                unsigned fourpix = *src++;
+
+                /* 32 bit RGB value */
+                unsigned int p;
+                //first "src" pixel
+                p = colors[fourpix & 0xff];
+                fb[dst[0]++] = p;  //top left
+                fb[dst[0]++] = p;  //top right
+                fb[dst[1]++] = p;  //bottom left
+                fb[dst[1]++] = p;  //bottom right
+
+                //second "src" pixel
+                p = colors[(fourpix >> 8) & 0xff];
+                fb[dst[0]++] = p;
+                fb[dst[0]++] = p;
+                fb[dst[1]++] = p;
+                fb[dst[1]++] = p;
+
+                //third "src" pixel
+                p = colors[(fourpix >> 16) & 0xff];
+                fb[dst[0]++] = p;
+                fb[dst[0]++] = p;
+                fb[dst[1]++] = p;
+                fb[dst[1]++] = p;
+
+                //fourth "src" pixel
+                p = colors[fourpix >> 24];
+                fb[dst[0]++] = p;
+                fb[dst[0]++] = p;
+                fb[dst[1]++] = p;
+                fb[dst[1]++] = p;
+            }
+            dst[0] += row_offset;
+            dst[1] += row_offset;
+            src += src_offset;
+        }
+        return;
+    }
+    if (multiply == 3)
+    {
+        /*start indices into frame buffer, one per row */
+        int dst[3] = {0, pitch, pitch + pitch};
+
+        for (int y = height; y; y--) {
+            for (int x = width; x; x -= 4) {
+                /* We process four "src" pixels per iteration
+                 * and for every source pixel, we write out 9 pixels to "dst".
+                 */
+                unsigned fourpix = *src++;
+
+                /* 32 bit RGB value */
+                unsigned int p;
+                //first "src" pixel
+                p = colors[fourpix & 0xff];
+                fb[dst[0]++] = p;  //top row, left
+                fb[dst[0]++] = p;  //top row, middle
+                fb[dst[0]++] = p;  //top row, right
+                fb[dst[1]++] = p;  //middle row, left
+                fb[dst[1]++] = p;  //middle row, middle
+                fb[dst[1]++] = p;  //middle row, right
+                fb[dst[2]++] = p;  //bottom row, left
+                fb[dst[2]++] = p;  //bottom row, middle
+                fb[dst[2]++] = p;  //bottom row, right
+
+                //second "src" pixel
+                p = colors[(fourpix >> 8) & 0xff];
+                fb[dst[0]++] = p;
+                fb[dst[0]++] = p;
+                fb[dst[0]++] = p;
+                fb[dst[1]++] = p;
+                fb[dst[1]++] = p;
+                fb[dst[1]++] = p;
+                fb[dst[2]++] = p;
+                fb[dst[2]++] = p;
+                fb[dst[2]++] = p;
+
+                //third "src" pixel
+                p = colors[(fourpix >> 16) & 0xff];
+                fb[dst[0]++] = p;
+                fb[dst[0]++] = p;
+                fb[dst[0]++] = p;
+                fb[dst[1]++] = p;
+                fb[dst[1]++] = p;
+                fb[dst[1]++] = p;
+                fb[dst[2]++] = p;
+                fb[dst[2]++] = p;
+                fb[dst[2]++] = p;
+
+                //fourth "src" pixel
+                p = colors[fourpix >> 24];
+                fb[dst[0]++] = p;
+                fb[dst[0]++] = p;
+                fb[dst[0]++] = p;
+                fb[dst[1]++] = p;
+                fb[dst[1]++] = p;
+                fb[dst[1]++] = p;
+                fb[dst[2]++] = p;
+                fb[dst[2]++] = p;
+                fb[dst[2]++] = p;
+            }
+
+            //each dst moves two pixel rows forward
+            dst[0] += row_offset;
+            dst[1] += row_offset;
+            dst[2] += row_offset;
+            src += src_offset;
+        }
+        return;
+    }
+}
+
+
+#ifdef BLIT_X86
+
+/*
+ * SSE2 blitter. SSE2 has no gather instruction, so the palette lookup is
+ * still done one pixel at a time, but the four looked-up values are
+ * assembled in a register, widened with shuffles, and written out with
+ * 16 byte stores to every replicated row.
+ */
+__attribute__((target("sse2"))) static void
+I_BlitSSE2 (uint32_t* fb, int pitch, const byte* screen,
+        const uint32_t* colors, int multiply, int width, int height)
+{
+    for (int y = 0; y < height; y++) {
+        const unsigned int *src =
+                (const unsigned int *) (screen + y * SCREENWIDTH);
+        __m128i *row0 = (__m128i *) (fb + (y * multiply) * pitch);
+        __m128i *row1 = (__m128i *) ((uint32_t *) row0 + pitch);
+        __m128i *row2 = (__m128i *) ((uint32_t *) row1 + pitch);
+
+        for (int x = width; x; x -= 4) {
+            unsigned int fourpix = *src++;
+            /* lane 0 holds the leftmost pixel */
+            __m128i p = _mm_setr_epi32(colors[fourpix & 0xff],
+                                       colors[(fourpix >> 8) & 0xff],
+                                       colors[(fourpix >> 16) & 0xff],
+                                       colors[fourpix >> 24]);
+            if (multiply == 1) {
+                _mm_storeu_si128(row0++, p);
+            } else if (multiply == 2) {
+                /* p0 p0 p1 p1 | p2 p2 p3 p3 */
+                __m128i a = _mm_unpacklo_epi32(p, p);
+                __m128i b = _mm_unpackhi_epi32(p, p);
+                _mm_storeu_si128(row0++, a);
+                _mm_storeu_si128(row0++, b);
+                _mm_storeu_si128(row1++, a);
+                _mm_storeu_si128(row1++, b);
+            } else {
+                /* p0 p0 p0 p1 | p1 p1 p2 p2 | p2 p3 p3 p3 */
+                __m128i a = _mm_shuffle_epi32(p, _MM_SHUFFLE(1, 0, 0, 0));
+                __m128i b = _mm_shuffle_epi32(p, _MM_SHUFFLE(2, 2, 1, 1));
+                __m128i c = _mm_shuffle_epi32(p, _MM_SHUFFLE(3, 3, 3, 2));
+                _mm_storeu_si128(row0++, a);
+                _mm_storeu_si128(row0++, b);
+                _mm_storeu_si128(row0++, c);
+                _mm_storeu_si128(row1++, a);
+                _mm_storeu_si128(row1++, b);
+                _mm_storeu_si128(row1++, c);
+                _mm_storeu_si128(row2++, a);
+                _mm_storeu_si128(row2++, b);
+                _mm_storeu_si128(row2++, c);
+            }
+        }
+    }
+}
+
+
+/*
+ * AVX2 blitter. Eight source pixels are zero-extended to 32 bit indices and
+ * looked up with one gather; the result is widened with cross-lane
+ * permutes and written out with 32 byte stores.
+ */
+__attribute__((target("avx2"))) static void
+I_BlitAVX2 (uint32_t* fb, int pitch, const byte* screen,
+        const uint32_t* colors, int multiply, int width, int height)
+{
+    const __m256i dup2a = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+    const __m256i dup2b = _mm256_setr_epi32(4, 4, 5, 5, 6, 6, 7, 7);
+    const __m256i dup3a = _mm256_setr_epi32(0, 0, 0, 1, 1, 1, 2, 2);
+    const __m256i dup3b = _mm256_setr_epi32(2, 3, 3, 3, 4, 4, 4, 5);
+    const __m256i dup3c = _mm256_setr_epi32(5, 5, 6, 6, 6, 7, 7, 7);
+
+    for (int y = 0; y < height; y++) {
+        const byte *src = screen + y * SCREENWIDTH;
+        __m256i *row0 = (__m256i *) (fb + (y * multiply) * pitch);
+        __m256i *row1 = (__m256i *) ((uint32_t *) row0 + pitch);
+        __m256i *row2 = (__m256i *) ((uint32_t *) row1 + pitch);
+
+        for (int x = width; x; x -= 8, src += 8) {
+            __m256i idx = _mm256_cvtepu8_epi32(
+                    _mm_loadl_epi64((const __m128i *) src));
+            __m256i p = _mm256_i32gather_epi32((const int *) colors, idx, 4);
+            if (multiply == 1) {
+                _mm256_storeu_si256(row0++, p);
+            } else if (multiply == 2) {
+                __m256i a = _mm256_permutevar8x32_epi32(p, dup2a);
+                __m256i b = _mm256_permutevar8x32_epi32(p, dup2b);
+                _mm256_storeu_si256(row0++, a);
+                _mm256_storeu_si256(row0++, b);
+                _mm256_storeu_si256(row1++, a);
+                _mm256_storeu_si256(row1++, b);
+            } else {
+                __m256i a = _mm256_permutevar8x32_epi32(p, dup3a);
+                __m256i b = _mm256_permutevar8x32_epi32(p, dup3b);
+                __m256i c = _mm256_permutevar8x32_epi32(p, dup3c);
+                _mm256_storeu_si256(row0++, a);
+                _mm256_storeu_si256(row0++, b);
+                _mm256_storeu_si256(row0++, c);
+                _mm256_storeu_si256(row1++, a);
+                _mm256_storeu_si256(row1++, b);
+                _mm256_storeu_si256(row1++, c);
+                _mm256_storeu_si256(row2++, a);
+                _mm256_storeu_si256(row2++, b);
+                _mm256_storeu_si256(row2++, c);
+            }
+        }
+    }
+}
+
+
+static boolean
+I_CPUHasSSE2 (void)
+{
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+    return (edx & bit_SSE2) != 0;
+}
+
+
+static boolean
+I_CPUHasAVX2 (void)
+{
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+    /* The CPU must support AVX and the kernel must have enabled saving of
+     * the YMM registers (XCR0 bits 1 and 2); otherwise the first AVX
+     * instruction faults. */
+    if (!(ecx & bit_AVX) || !(ecx & bit_OSXSAVE)) {
+        return false;
+    }
+    unsigned int xcr0_lo, xcr0_hi;
+    __asm__ volatile ("xgetbv" : "=a" (xcr0_lo), "=d" (xcr0_hi) : "c" (0));
+    if ((xcr0_lo & 6) != 6) {
+        return false;
+    }
+    if (__get_cpuid_max(0, NULL) < 7) {
+        return false;
+    }
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    return (ebx & bit_AVX2) != 0;
+}
+
+#endif /* BLIT_X86 */
+
+
+/* all blitters, slowest first */
+static const blitter_t blitters[] =
+{
+    {"scalar", I_BlitScalar},
+#ifdef BLIT_X86
+    {"sse2", I_BlitSSE2},
+    {"avx2", I_BlitAVX2},
+#endif
+};
+
+#define NUMBLITTERS (sizeof(blitters) / sizeof(blitters[0]))
+
+
+static boolean
+I_BlitterSupported (const blitter_t* b)
+{
+#ifdef BLIT_X86
+    if (b->blit == I_BlitSSE2) {
+        return I_CPUHasSSE2();
+    }
+    if (b->blit == I_BlitAVX2) {
+        return I_CPUHasAVX2();
+    }
+#endif
+    return true;
+}
+
+
+const blitter_t*
+I_SelectBlitter (boolean nosimd)
+{
+    const blitter_t* best = &blitters[0];
+    if (nosimd) {
+        return best;
+    }
+    for (int i = 1; i < NUMBLITTERS; i++) {
+        if (I_BlitterSupported(&blitters[i])) {
+            best = &blitters[i];
+        }
+    }
+    return best;
+}
+
+
+void
+I_AspectArea (int width, int height, int* w, int* h)
+{
+    *w = width;
+    *h = width * 3 / 4;
+    if (*h > height) {
+        *h = height;
+        *w = height * 4 / 3;
+    }
+}
+
+
+/*
+ * Fills "start" with the first destination index of every source index,
+ * for "n" source and "size" destination indices. Destination index i
+ * samples the source at the center of the pixel, (i + 0.5) * n / size,
+ * which for size = n * m is the same as i / m.
+ */
+static void
+I_ScaleTable (int* start, int n, int size)
+{
+    int i = 0;
+    for (int src = 0; src < n; src++) {
+        while (i < size && (2 * i + 1) * n / (2 * size) < src) {
+            i++;
+        }
+        start[src] = i;
+    }
+    start[n] = size;
+}
+
+
+void
+I_InitScaler (scaler_t* s, int width, int height)
+{
+    s->width = width;
+    s->height = height;
+    s->multiply = 0;
+    for (int m = 1; m <= 3; m++) {
+        if (width == SCREENWIDTH * m && height == SCREENHEIGHT * m) {
+            s->multiply = m;
+        }
+    }
+
+    I_ScaleTable(s->colstart, SCREENWIDTH, width);
+    I_ScaleTable(s->rowstart, SCREENHEIGHT, height);
+
+    s->colsrc = malloc(width * sizeof(*s->colsrc));
+    s->line = malloc(width * sizeof(*s->line));
+    if (s->colsrc == NULL || s->line == NULL) {
+        I_Error("I_InitScaler: out of memory");
+    }
+    for (int x = 0; x < SCREENWIDTH; x++) {
+        for (int i = s->colstart[x]; i < s->colstart[x + 1]; i++) {
+            s->colsrc[i] = x;
+        }
+    }
+}
+
+
+void
+I_Scale (const scaler_t* s, const blitter_t* b, uint32_t* dst, int pitch,
+        const byte* screen, const uint32_t* colors,
+        int x1, int x2, int y1, int y2)
+{
+    if (s->multiply) {
+        const int m = s->multiply;
+        b->blit(dst + (y1 * pitch + x1) * m, pitch,
+                screen + y1 * SCREENWIDTH + x1, colors, m, x2 - x1, y2 - y1);
+        return;
+    }
+
+    /* Every source row is expanded once into "line", which is then copied
+     * to all destination rows showing it; the frame buffer is never read. */
+    const int dx1 = s->colstart[x1];
+    const int dx2 = s->colstart[x2];
+    const size_t size = (dx2 - dx1) * sizeof(*s->line);
+    for (int y = y1; y < y2; y++) {
+        const int dy1 = s->rowstart[y];
+        const int dy2 = s->rowstart[y + 1];
+        if (dy1 == dy2) {
+            /* row dropped when scaling down */
+            continue;
+        }
+        const byte* src = screen + y * SCREENWIDTH;
+        for (int x = dx1; x < dx2; x++) {
+            s->line[x] = colors[src[s->colsrc[x]]];
+        }
+        for (int dy = dy1; dy < dy2; dy++) {
+            memcpy(dst + dy * pitch + dx1, s->line + dx1, size);
+        }
+    }
+}
+
+
+//
+// I_BlitBenchmark
+// Every blitter runs BLITBENCH_FRAMES times per multiply factor, first into
+// a buffer in normal (cached) memory, then into the real frame buffer if the
+// factor fits the current graphics mode. The output of every blitter is
+// compared against the output of the plain C blitter. Then the scaler is
+// timed the same way for every output mode; for the integer factors, the
+// table driven path is forced and checked against the blitters.
+//
+#define BLITBENCH_FRAMES	200
+
+static unsigned int
+I_TimeBlitter (const blitter_t* b, uint32_t* dst, int pitch,
+        const byte* src, const uint32_t* colors, int multiply)
+{
+    unsigned int start = sel4doom_get_current_time();
+    for (int i = 0; i < BLITBENCH_FRAMES; i++) {
+        b->blit(dst, pitch, src, colors, multiply, SCREENWIDTH, SCREENHEIGHT);
+    }
+    return sel4doom_get_current_time() - start;
+}
+
+
+static unsigned int
+I_TimeScaler (const scaler_t* s, uint32_t* dst, int pitch,
+        const byte* src, const uint32_t* colors)
+{
+    unsigned int start = sel4doom_get_current_time();
+    for (int i = 0; i < BLITBENCH_FRAMES; i++) {
+        I_Scale(s, &blitters[0], dst, pitch, src, colors,
+                0, SCREENWIDTH, 0, SCREENHEIGHT);
+    }
+    return sel4doom_get_current_time() - start;
+}
+
+
+static void
+I_ScalerBenchmark (uint32_t* fb, int width, int height, const byte* src,
+        const uint32_t* colors)
+{
+    static const char* names[] = {"1x", "2x", "3x", "aspect", "stretch"};
+
+    printf("blitbench: %-8s %9s %8s %8s\n", "scaler", "size", "mem", "fb");
+    for (int mode = 0; mode < 5; mode++) {
+        int w, h;
+        if (mode < 3) {
+            w = SCREENWIDTH * (mode + 1);
+            h = SCREENHEIGHT * (mode + 1);
+        } else if (mode == 3) {
+            I_AspectArea(width, height, &w, &h);
+        } else {
+            w = width;
+            h = height;
+        }
+        if (w < SCREENWIDTH || h < SCREENHEIGHT) {
+            continue;
+        }
+
+        scaler_t s;
+        I_InitScaler(&s, w, h);
+        uint32_t* mem = calloc(w * h, sizeof(uint32_t));
+        uint32_t* ref = calloc(w * h, sizeof(uint32_t));
+        if (mem == NULL || ref == NULL) {
+            printf("blitbench: out of memory\n");
+            free(mem);
+            free(ref);
+            free(s.colsrc);
+            free(s.line);
+            return;
+        }
+        const char* check = "";
+        if (s.multiply) {
+            blitters[0].blit(ref, w, src, colors, s.multiply, SCREENWIDTH,
+                    SCREENHEIGHT);
+            s.multiply = 0;
+        }
+        unsigned int tmem = I_TimeScaler(&s, mem, w, src, colors);
+        if (mode < 3 && memcmp(mem, ref, w * h * sizeof(uint32_t))) {
+            check = "MISMATCH";
+        }
+
+        char size[20];
+        snprintf(size, sizeof(size), "%dx%d", w, h);
+        if (w <= width && h <= height) {
+            unsigned int tfb = I_TimeScaler(&s, fb, width, src, colors);
+            printf("blitbench: %-8s %9s %8u %8u %s\n", names[mode], size,
+                    tmem * 1000 / BLITBENCH_FRAMES,
+                    tfb * 1000 / BLITBENCH_FRAMES, check);
+        } else {
+            printf("blitbench: %-8s %9s %8u %8s %s\n", names[mode], size,
+                    tmem * 1000 / BLITBENCH_FRAMES, "-", check);
+        }
+        free(mem);
+        free(ref);
+        free(s.colsrc);
+        free(s.line);
+    }
+}
+
+
+void
+I_BlitBenchmark (uint32_t* fb, int width, int height)
+{
+    uint32_t colors[256];
+    const int mempitch = 3 * SCREENWIDTH;
+    const size_t memsize = 3 * SCREENHEIGHT * mempitch * sizeof(uint32_t);
+    byte* src = malloc(SCREENWIDTH * SCREENHEIGHT);
+    uint32_t* ref = malloc(memsize);
+    uint32_t* mem = malloc(memsize);
+    if (src == NULL || ref == NULL || mem == NULL) {
+        printf("blitbench: out of memory\n");
+        free(src);
+        free(ref);
+        free(mem);
+        return;
+    }
+    /* a palette with distinct entries, so that mix-ups are detected */
+    for (int i = 0; i < 256; i++) {
+        colors[i] = (i << 16) | ((255 - i) << 8) | (i ^ 0x5a);
+    }
+    /* a pattern that touches every palette entry in every column */
+    for (int i = 0; i < SCREENWIDTH * SCREENHEIGHT; i++) {
+        src[i] = (byte) (i * 7 + i / SCREENWIDTH);
+    }
+
+    printf("blitbench: %d frames per run; times in us per frame\n",
+            BLITBENCH_FRAMES);
+    printf("blitbench: %-8s %8s %8s %8s\n", "blitter", "multiply", "mem", "fb");
+    for (int multiply = 1; multiply <= 3; multiply++) {
+        memset(ref, 0, memsize);
+        blitters[0].blit(ref, mempitch, src, colors, multiply, SCREENWIDTH,
+                SCREENHEIGHT);
+
+        for (int i = 0; i < NUMBLITTERS; i++) {
+            const blitter_t* b = &blitters[i];
+            if (!I_BlitterSupported(b)) {
+                printf("blitbench: %-8s %8d   (not supported by this CPU)\n",
+                        b->name, multiply);
+                continue;
+            }
+            memset(mem, 0, memsize);
+            unsigned int tmem = I_TimeBlitter(b, mem, mempitch, src, colors,
+                    multiply);
+            boolean ok = memcmp(mem, ref, memsize) == 0;
+
+            if (SCREENWIDTH * multiply <= width
+                    && SCREENHEIGHT * multiply <= height) {
+                unsigned int tfb = I_TimeBlitter(b, fb, width, src, colors,
+                        multiply);
+                printf("blitbench: %-8s %8d %8u %8u %s\n", b->name, multiply,
+                        tmem * 1000 / BLITBENCH_FRAMES,
+                        tfb * 1000 / BLITBENCH_FRAMES,
+                        ok ? "" : "MISMATCH");
+            } else {
+                printf("blitbench: %-8s %8d %8u %8s %s\n", b->name, multiply,
+                        tmem * 1000 / BLITBENCH_FRAMES, "-",
+                        ok ? "" : "MISMATCH");
+            }
+        }
+    }
+    free(ref);
+    free(mem);
+
+    I_ScalerBenchmark(fb, width, height, src, colors);
+    free(src);
+}
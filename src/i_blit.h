@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2015, Josef Mihalits
+ *
+ * This software may be distributed and modified according to the terms of
+ * the GNU General Public License version 2. Note that NO WARRANTY is provided.
+ * See "COPYING" for details.
+ *
+ */
+
+#ifndef __I_BLIT__
+#define __I_BLIT__
+
+#include <stdint.h>
+
+#include "doomtype.h"
+
+
+/*
+ * A blitter expands a width x height rectangle of the 8-bit screen through
+ * the palette "colors" into the 32bpp buffer "dst" and replicates every
+ * source pixel multiply x multiply times (multiply is 1, 2, or 3).
+ * "src" and "dst" point to the top left corner of the rectangle; rows of
+ * "src" are SCREENWIDTH apart, rows of "dst" "pitch" pixels. "width" must
+ * be a multiple of BLITALIGN.
+ */
+#define BLITALIGN 8
+
+typedef void (*blitfunc_t) (uint32_t* dst, int pitch, const byte* src,
+        const uint32_t* colors, int multiply, int width, int height);
+
+typedef struct
+{
+    const char*	name;
+    blitfunc_t	blit;
+} blitter_t;
+
+
+/*
+ * A scaler maps the SCREENWIDTH x SCREENHEIGHT screen onto a width x height
+ * area of any size, nearest neighbour, through tables of source indices.
+ * If the area is an integer multiple of the screen, "multiply" is set and
+ * the blitters above do the work.
+ */
+typedef struct
+{
+    int		width;
+    int		height;
+    int		multiply;	/* 1, 2, 3, or 0 for the table driven path */
+    short*	colsrc;		/* [width] source column of every column */
+    int		colstart[MAXSCREENWIDTH + 1];  /* first column of every source column */
+    int		rowstart[MAXSCREENHEIGHT + 1]; /* first row of every source row */
+    uint32_t*	line;		/* [width] one expanded row */
+} scaler_t;
+
+
+/* Returns the fastest blitter supported by the CPU we are running on;
+ * the plain C blitter is returned if "nosimd" is set. */
+const blitter_t* I_SelectBlitter (boolean nosimd);
+
+/* The largest area with the 4:3 aspect of the original 320x200 mode on a
+ * CRT (i.e. 1.2 times higher) that fits into width x height. */
+void I_AspectArea (int width, int height, int* w, int* h);
+
+/* Sets up "s" for an area of width x height pixels. */
+void I_InitScaler (scaler_t* s, int width, int height);
+
+/* Scales the part x1 <= x < x2, y1 <= y < y2 of "screen" into the area at
+ * "dst"; "pitch" is the distance between two rows of "dst" in pixels. x1
+ * and x2 must be multiples of BLITALIGN. */
+void I_Scale (const scaler_t* s, const blitter_t* b, uint32_t* dst,
+        int pitch, const byte* screen, const uint32_t* colors,
+        int x1, int x2, int y1, int y2);
+
+/* Times all blitters supported by this CPU for multiply 1, 2, and 3, and
+ * the scaler for the output modes of a width x height frame buffer, and
+ * prints the results to the console. */
+void I_BlitBenchmark (uint32_t* fb, int width, int height);
+
+
+#endif
@@ -30,6 +30,11 @@ rcsid[] = "$Id: m_bbox.c,v 1.1 1997/02/03 22:45:10 b1 Exp $";
 
 #include "doomdef.h"
 #include "m_misc.h"
+#include "m_argv.h"
+#include "w_wad.h"
+#include "r_main.h"
+#include "p_tick.h"
+#include "m_prof.h"
 #include "i_video.h"
 #include "i_sound.h"
 
@@ -120,6 +125,14 @@ void I_Quit (void)
     I_ShutdownSound();
     I_ShutdownMusic();
     M_SaveDefaults ();
+    if (M_CheckParm ("-wadstats"))
+	W_PrintLookupStats ();
+    if (M_CheckParm ("-renderstats"))
+	R_PrintStats ();
+    if (M_CheckParm ("-mobjstats"))
+	P_PrintStats ();
+    if (profiling)
+	M_ProfileDump ();
     I_ShutdownGraphics();
     exit(0);
 }
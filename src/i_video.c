@@ -23,6 +23,7 @@
 
 
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 
@@ -32,16 +33,27 @@
 #include "v_video.h"
 #include "m_argv.h"
 #include "d_main.h"
+#include "i_blit.h"
+#include "w_wad.h"
+#include "z_zone.h"
 
 #include "doomdef.h"
 #include "sel4_doom.h"
 #include "sel4.local/libplatsupport/keyboard_vkey.h"
 
-/* the current color palette in 32bit format as used by frame buffer */
-static uint32_t sel4doom_colors32[256];
+/* the current color palette in 32bit format as used by frame buffer;
+ * points into palettecache or to othercolors32 */
+static const uint32_t* sel4doom_colors32 = NULL;
 
-/* the current color table: one byte for red, one for green, one for blue */
-static uint8_t sel4doom_colors[256][3];
+/* All PLAYPAL palettes in frame buffer format, for every gamma level:
+ * [usegamma][numpalettes][256], built by I_InitPalettes. Switching to one
+ * of them is a pointer swap. */
+static uint32_t* palettecache = NULL;
+static byte* playpal = NULL;
+static int numpalettes = 0;
+
+/* expansion of a palette that is not in PLAYPAL */
+static uint32_t othercolors32[256];
 
 /* VBE mode info */
 static seL4_VBEModeInfoBlock mib;
@@ -52,14 +64,21 @@ static uint32_t* sel4doom_fb = NULL;
 /* current ID of image displayed during game play; -1 = no image */
 static int sel4doom_imgId = -1;
 
-/* This version of DOOM uses 320 pixels per row. Because of "blocky" mode
- * (multiply * 320) pixels are displayed per row. The number of pixels on the real
- * screen is determined by the current graphics mode and is given by mib.xRes.
- * If mib.xRes is not a multiple of 320, then a black margin area remains
- * between the content area and the screen area. row_offset is the width of this
- * margin area and the number of pixel rows that are skipped in "blocky" mode.
+/* This version of DOOM uses 320 pixels per row. The output area on the real
+ * screen is either "blocky" mode, (multiply * 320) pixels per row at the top
+ * left, or with "-aspect" or "-stretch" an area of any size, centered. The
+ * number of pixels on the real screen is determined by the current graphics
+ * mode and is given by mib.xRes. A black margin area remains between the
+ * content area and the screen area.
  */
-static uint32_t row_offset = 0;
+
+/* palette expansion routine used by I_FinishUpdate (see i_blit.c) */
+static const blitter_t* blitter = NULL;
+
+/* Only the spans of screens[0] marked by V_MarkRect are copied to the frame
+ * buffer, unless the palette changed or "-fullblit" is given. */
+static int fullblit = 0;
+static int palettechanged = 1;
 
 // Blocky mode,
 // replace each 320x200 pixel with multiply*multiply pixels.
@@ -67,6 +86,23 @@ static uint32_t row_offset = 0;
 // to use ....
 static uint32_t	multiply = 1;
 
+/* maps screens[0] onto the output area, which starts at "output" */
+static scaler_t scaler;
+static uint32_t* output = NULL;
+
+/* Pipelined output ("-pipeline"): I_FinishUpdate hands a copy of screens[0]
+ * and of the palette to the present thread, which expands them into the
+ * frame buffer while the main thread goes on with the next tics and frame.
+ * presentdone is posted when the copy may be overwritten again. */
+static int pipeline = 0;
+static byte* presentscreen = NULL;
+static const uint32_t* presentcolors = NULL;
+static uint32_t presentcolors32[256];
+static short presentleft[MAXSCREENHEIGHT];
+static short presentright[MAXSCREENHEIGHT];
+static void* presentready = NULL;
+static void* presentdone = NULL;
+
 
 /*
  * Set all pixels to black.
@@ -86,7 +122,7 @@ static uint8_t*
 sel4doom_get_ppm(int imgId) {
     char filename[20];
     sprintf(filename, "logo%d.ppm", imgId);
-    void * img = sel4doom_load_file(filename);
+    void * img = sel4doom_load_file(filename, NULL);
     assert(img);
 
     int imgx = 0;  // image width (in pixel)
@@ -120,9 +156,10 @@ sel4doom_get_ppm(int imgId) {
                 int minidx = 0;
                 int mindist = 0;
                 for (int i = 0; i < 256; i++) {
-                    int dist = abs(r - sel4doom_colors[i][0])
-                             + abs(g - sel4doom_colors[i][1])
-                             + abs(b - sel4doom_colors[i][2]);
+                    uint32_t c = sel4doom_colors32[i];
+                    int dist = abs(r - (int) ((c >> mib.linRedOff) & 0xff))
+                             + abs(g - (int) ((c >> mib.linGreenOff) & 0xff))
+                             + abs(b - (int) ((c >> mib.linBlueOff) & 0xff));
                     if (i == 0 || dist < mindist) {
                         minidx = i;
                         mindist = dist;
@@ -171,6 +208,7 @@ sel4doom_diplay_ppm (int imgId) {
             }
         }
     }
+    V_MarkRect(startx, starty, imgx, imgy);
 }
 
 
@@ -331,6 +369,11 @@ sel4doom_poll_event(event_t* event) {
 
 void I_ShutdownGraphics(void)
 {
+    if (pipeline) {
+        /* let the present thread finish the last frame */
+        sel4doom_sem_wait(presentdone);
+        pipeline = 0;
+    }
     sel4doom_clear_screen();
 }
 
@@ -364,6 +407,35 @@ void I_UpdateNoBlit (void)
 }
 
 
+/*
+ * Copies the dirty spans of "screen" to the output area. The spans are
+ * widened to multiples of BLITALIGN pixels, and runs of rows with the same
+ * span go to the blitter in one call.
+ */
+static void
+I_BlitDirty(const byte* screen, const uint32_t* colors,
+        const short* left, const short* right) {
+    int y = 0;
+    while (y < SCREENHEIGHT) {
+        if (left[y] > right[y]) {
+            y++;
+            continue;
+        }
+        int x1 = left[y] & ~(BLITALIGN - 1);
+        int x2 = (right[y] | (BLITALIGN - 1)) + 1;
+        int y1 = y;
+        for (y++; y < SCREENHEIGHT && left[y] <= right[y]; y++) {
+            if ((left[y] & ~(BLITALIGN - 1)) != x1
+                    || (right[y] | (BLITALIGN - 1)) + 1 != x2) {
+                break;
+            }
+        }
+        I_Scale(&scaler, blitter, output, mib.xRes, screen, colors,
+                x1, x2, y1, y);
+    }
+}
+
+
 //
 // I_FinishUpdate
 //
@@ -387,158 +459,32 @@ void I_FinishUpdate (void)
         for ( ; i<20*2 ; i+=2) {
             screens[0][ (SCREENHEIGHT-1)*SCREENWIDTH + i] = 0x0;
         }
+        V_MarkRect(0, SCREENHEIGHT - 1, 20 * 2, 1);
     }
     if (sel4doom_imgId != -1) {
         sel4doom_diplay_ppm(sel4doom_imgId);
     }
-    // ------------------------
-    if (multiply == 1)
-    {
-        unsigned int *src = (unsigned int *) screens[0];
-        unsigned int *dst = sel4doom_fb;
-        for (int y = SCREENHEIGHT; y; y--) {
-            for (int x = SCREENWIDTH; x; x -= 4) {
-                /* We process four pixels per iteration. */
-                unsigned int fourpix = *src++;
-
-                //first "src" pixel
-                *dst++ = sel4doom_colors32[fourpix & 0xff];
-                //second "src" pixel
-                *dst++ = sel4doom_colors32[(fourpix >> 8) & 0xff];
-                //third "src" pixel
-                *dst++ = sel4doom_colors32[(fourpix >> 16) & 0xff];
-                //fourth "src" pixel
-                *dst++ = sel4doom_colors32[fourpix >> 24];
-            }
-            dst += row_offset;
-        }
-        return;
+    if (fullblit || palettechanged) {
+        V_MarkRect(0, 0, SCREENWIDTH, SCREENHEIGHT);
+        palettechanged = 0;
     }
-    // ------------------------
-    if (multiply == 2)
-    {
-        /* pointer into source screen */
-        unsigned int *src = (unsigned int *) (screens[0]);
-
-        /*indices into frame buffer, one per row */
-        int dst[2] = {0, mib.xRes};
-
-        for (int y = SCREENHEIGHT; y; y--) {
-            for (int x = SCREENWIDTH; x; x -= 4) {
-                /* We process four "src" pixels per iteration
-                 * and for every source pixel, we write out 4 pixels to "dst".
-                 */
-                unsigned fourpix = *src++;
-
-                /* 32 bit RGB value */
-                unsigned int p;
-                //first "src" pixel
-                p = sel4doom_colors32[fourpix & 0xff];
-                sel4doom_fb[dst[0]++] = p;  //top left
-                sel4doom_fb[dst[0]++] = p;  //top right
-                sel4doom_fb[dst[1]++] = p;  //bottom left
-                sel4doom_fb[dst[1]++] = p;  //bottom right
-
-                //second "src" pixel
-                p = sel4doom_colors32[(fourpix >> 8) & 0xff];
-                sel4doom_fb[dst[0]++] = p;
-                sel4doom_fb[dst[0]++] = p;
-                sel4doom_fb[dst[1]++] = p;
-                sel4doom_fb[dst[1]++] = p;
-
-                //third "src" pixel
-                p = sel4doom_colors32[(fourpix >> 16) & 0xff];
-                sel4doom_fb[dst[0]++] = p;
-                sel4doom_fb[dst[0]++] = p;
-                sel4doom_fb[dst[1]++] = p;
-                sel4doom_fb[dst[1]++] = p;
-
-                //fourth "src" pixel
-                p = sel4doom_colors32[fourpix >> 24];
-                sel4doom_fb[dst[0]++] = p;
-                sel4doom_fb[dst[0]++] = p;
-                sel4doom_fb[dst[1]++] = p;
-                sel4doom_fb[dst[1]++] = p;
-            }
-            dst[0] += row_offset;
-            dst[1] += row_offset;
-        }
-        return;
-    }
-    if (multiply == 3)
-    {
-        /* pointer into source screen */
-        unsigned int *src = (unsigned int *) (screens[0]);
-
-        /*start indices into frame buffer, one per row */
-        int dst[3] = {0, mib.xRes, mib.xRes + mib.xRes};
-
-        for (int y = SCREENHEIGHT; y; y--) {
-            for (int x = SCREENWIDTH; x; x -= 4) {
-                /* We process four "src" pixels per iteration
-                 * and for every source pixel, we write out 9 pixels to "dst".
-                 */
-                unsigned fourpix = *src++;
-
-                /* 32 bit RGB value */
-                unsigned int p;
-                //first "src" pixel
-                p = sel4doom_colors32[fourpix & 0xff];
-                sel4doom_fb[dst[0]++] = p;  //top row, left
-                sel4doom_fb[dst[0]++] = p;  //top row, middle
-                sel4doom_fb[dst[0]++] = p;  //top row, right
-                sel4doom_fb[dst[1]++] = p;  //middle row, left
-                sel4doom_fb[dst[1]++] = p;  //middle row, middle
-                sel4doom_fb[dst[1]++] = p;  //middle row, right
-                sel4doom_fb[dst[2]++] = p;  //bottom row, left
-                sel4doom_fb[dst[2]++] = p;  //bottom row, middle
-                sel4doom_fb[dst[2]++] = p;  //bottom row, right
-
-                //second "src" pixel
-                p = sel4doom_colors32[(fourpix >> 8) & 0xff];
-                sel4doom_fb[dst[0]++] = p;
-                sel4doom_fb[dst[0]++] = p;
-                sel4doom_fb[dst[0]++] = p;
-                sel4doom_fb[dst[1]++] = p;
-                sel4doom_fb[dst[1]++] = p;
-                sel4doom_fb[dst[1]++] = p;
-                sel4doom_fb[dst[2]++] = p;
-                sel4doom_fb[dst[2]++] = p;
-                sel4doom_fb[dst[2]++] = p;
-
-                //third "src" pixel
-                p = sel4doom_colors32[(fourpix >> 16) & 0xff];
-                sel4doom_fb[dst[0]++] = p;
-                sel4doom_fb[dst[0]++] = p;
-                sel4doom_fb[dst[0]++] = p;
-                sel4doom_fb[dst[1]++] = p;
-                sel4doom_fb[dst[1]++] = p;
-                sel4doom_fb[dst[1]++] = p;
-                sel4doom_fb[dst[2]++] = p;
-                sel4doom_fb[dst[2]++] = p;
-                sel4doom_fb[dst[2]++] = p;
-
-                //fourth "src" pixel
-                p = sel4doom_colors32[fourpix >> 24];
-                sel4doom_fb[dst[0]++] = p;
-                sel4doom_fb[dst[0]++] = p;
-                sel4doom_fb[dst[0]++] = p;
-                sel4doom_fb[dst[1]++] = p;
-                sel4doom_fb[dst[1]++] = p;
-                sel4doom_fb[dst[1]++] = p;
-                sel4doom_fb[dst[2]++] = p;
-                sel4doom_fb[dst[2]++] = p;
-                sel4doom_fb[dst[2]++] = p;
-            }
-
-            //each dst moves two pixel rows forward
-            dst[0] += row_offset;
-            dst[1] += row_offset;
-            dst[2] += row_offset;
+    if (pipeline) {
+        /* wait until the present thread is done with the previous frame */
+        sel4doom_sem_wait(presentdone);
+        memcpy(presentscreen, screens[0], SCREENWIDTH * SCREENHEIGHT);
+        /* the tables in palettecache never change, othercolors32 may */
+        presentcolors = sel4doom_colors32;
+        if (presentcolors == othercolors32) {
+            memcpy(presentcolors32, othercolors32, sizeof(presentcolors32));
+            presentcolors = presentcolors32;
         }
-        return;
+        memcpy(presentleft, dirtyleft, sizeof(presentleft));
+        memcpy(presentright, dirtyright, sizeof(presentright));
+        sel4doom_sem_post(presentready);
+    } else {
+        I_BlitDirty(screens[0], sel4doom_colors32, dirtyleft, dirtyright);
     }
-    I_Error("Unsupported 'multiply' factor.");
+    V_ClearDirty();
 }
 
 
@@ -551,26 +497,96 @@ void I_ReadScreen (byte* scr)
 }
 
 
+/*
+ * Gamma corrects the color rgb[0..2] and packs it into frame buffer format.
+ */
+static uint32_t
+I_PackColor(int gamma, const byte* rgb) {
+    return (gammatable[gamma][rgb[0]] << mib.linRedOff)
+         | (gammatable[gamma][rgb[1]] << mib.linGreenOff)
+         | (gammatable[gamma][rgb[2]] << mib.linBlueOff);
+}
+
+
+/*
+ * Expands every palette of the PLAYPAL lump for every gamma level.
+ */
+static void
+I_InitPalettes(void) {
+    int lump = W_GetNumForName("PLAYPAL");
+    playpal = W_CacheLumpNum(lump, PU_STATIC);
+    numpalettes = W_LumpLength(lump) / 768;
+    palettecache = malloc(5 * numpalettes * 256 * sizeof(uint32_t));
+    if (palettecache == NULL) {
+        I_Error("Couldn't allocate palette cache");
+    }
+    uint32_t* dst = palettecache;
+    for (int gamma = 0; gamma < 5; gamma++) {
+        for (int i = 0; i < numpalettes * 256; i++) {
+            *dst++ = I_PackColor(gamma, playpal + i * 3);
+        }
+    }
+}
+
+
 //
 // I_SetPalette
 //
 void I_SetPalette (byte* palette)
 {
-    for (int i = 0; i < 256; i++) {
-        byte r = gammatable[usegamma][*palette++];
-        byte g = gammatable[usegamma][*palette++];
-        byte b = gammatable[usegamma][*palette++];
-        sel4doom_colors[i][0] = r;
-        sel4doom_colors[i][1] = g;
-        sel4doom_colors[i][2] = b;
-        sel4doom_colors32[i] =
-                      (r << mib.linRedOff)
-                    | (g << mib.linGreenOff)
-                    | (b << mib.linBlueOff);
+    const uint32_t* colors;
+
+    if (palettecache == NULL) {
+        /* too early; I_InitGraphics sets the first palette */
+        return;
+    }
+    if (palette >= playpal && palette < playpal + numpalettes * 768
+            && (palette - playpal) % 768 == 0) {
+        colors = palettecache
+                + (usegamma * numpalettes + (palette - playpal) / 768) * 256;
+    } else {
+        for (int i = 0; i < 256; i++) {
+            othercolors32[i] = I_PackColor(usegamma, palette + i * 3);
+        }
+        colors = othercolors32;
+        palettechanged = 1;
+    }
+    if (sel4doom_colors32 != colors) {
+        sel4doom_colors32 = colors;
+        palettechanged = 1;
+    }
+}
+
+
+static void
+I_PresentThread(UNUSED void* arg) {
+    for (;;) {
+        sel4doom_sem_wait(presentready);
+        I_BlitDirty(presentscreen, presentcolors, presentleft, presentright);
+        sel4doom_sem_post(presentdone);
     }
 }
 
 
+/*
+ * Starts the present thread. There are no threads on seL4 (see
+ * sel4_main.c), so there -pipeline is an error rather than a no-op.
+ */
+static void
+I_InitPipeline(void) {
+    presentscreen = malloc(SCREENWIDTH * SCREENHEIGHT);
+    presentready = sel4doom_sem_create(0);
+    presentdone = sel4doom_sem_create(1);
+    if (presentscreen == NULL || presentready == NULL || presentdone == NULL
+            || sel4doom_thread_create(I_PresentThread, NULL)) {
+        I_Error("I_InitGraphics: -pipeline needs a present thread, "
+                "which this build cannot start");
+    }
+    pipeline = 1;
+    printf("seL4: I_InitGraphics: blitting on the present thread\n");
+}
+
+
 void I_InitGraphics(void) {
     sel4doom_fb = sel4doom_get_framebuffer_vaddr();
     if (sel4doom_fb == NULL) {
@@ -605,8 +621,45 @@ void I_InitGraphics(void) {
     } else {
         multiply = 1;
     }
-    printf("seL4: I_InitGraphics: setting multiply=%d\n", multiply);
 
-    row_offset = multiply * (mib.xRes - SCREENWIDTH);
+    // any other output size goes through the table driven scaler
+    int outw = SCREENWIDTH * multiply;
+    int outh = SCREENHEIGHT * multiply;
+    if (M_CheckParm("-aspect")) {
+        I_AspectArea(mib.xRes, mib.yRes, &outw, &outh);
+    } else if (M_CheckParm("-stretch")) {
+        outw = mib.xRes;
+        outh = mib.yRes;
+    }
+    if (outw > mib.xRes || outh > mib.yRes) {
+        // e.g. -hires on a small frame buffer: scale down to fit
+        I_AspectArea(mib.xRes, mib.yRes, &outw, &outh);
+    }
+    I_InitScaler(&scaler, outw, outh);
+    output = sel4doom_fb;
+    if (!scaler.multiply) {
+        output += (mib.yRes - outh) / 2 * mib.xRes + (mib.xRes - outw) / 2;
+    }
+    printf("seL4: I_InitGraphics: output %dx%d (multiply=%d)\n",
+            outw, outh, scaler.multiply);
+
+    // select palette expansion routine; -nosimd forces the plain C one
+    blitter = I_SelectBlitter(M_CheckParm("-nosimd"));
+    printf("seL4: I_InitGraphics: using %s blitter\n", blitter->name);
+
+    // -fullblit turns off the dirty span tracking
+    fullblit = M_CheckParm("-fullblit");
+
+    I_InitPalettes();
+    I_SetPalette(playpal);
+
+    if (M_CheckParm("-blitbench")) {
+        I_BlitBenchmark(sel4doom_fb, mib.xRes, mib.yRes);
+    }
+
     sel4doom_clear_screen();
+
+    if (M_CheckParm("-pipeline")) {
+        I_InitPipeline();
+    }
 }
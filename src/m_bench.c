@@ -0,0 +1,318 @@
+/*
+ * Copyright (c) 2015, Josef Mihalits
+ *
+ * This software may be distributed and modified according to the terms of
+ * the GNU General Public License version 2. Note that NO WARRANTY is provided.
+ * See "COPYING" for details.
+ *
+ */
+
+/*
+ * Benchmark mode.
+ *
+ * "-benchmark demo1 demo2 ..." plays the listed demos back to back as
+ * timedemos (one frame per tic, no wipes) and needs no keyboard input,
+ * so it can run unattended in QEMU with "-serial stdio". For every demo
+ * a CSV line is printed when it ends; after the last demo a JSON summary
+ * follows and the program exits.
+ *
+ * The per-phase times come from the frame profiler (m_prof.c):
+ *   sim    - P_Ticker
+ *   bsp    - R_RenderBSPNode
+ *   planes - R_DrawPlanes
+ *   masked - R_DrawMasked
+ *   blit   - I_FinishUpdate
+ *
+ * "-benchlayouts" plays every demo twice, drawing the view into the
+ * screen and into the column-major view buffer (see R_InitBuffer); the
+ * second run is reported as "demo/colmajor".
+ *
+ * "-benchbase file" compares the results with a baseline, i.e. the
+ * "bench," lines of an earlier run saved to a file in the cpio archive.
+ * A demo fails if its tic count differs from the baseline (the demo
+ * desynced) or its fps are more than "-benchtolerance percent" (default
+ * 5) below the baseline. If any demo fails, the program exits through
+ * I_Error.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "doomdef.h"
+#include "doomstat.h"
+#include "i_system.h"
+#include "m_argv.h"
+#include "r_main.h"
+#include "sel4_doom.h"
+
+#include "m_prof.h"
+#include "m_bench.h"
+
+
+#define MAXBENCHDEMOS	16
+#define BENCHTOLERANCE	5	// in percent
+
+typedef struct
+{
+    char*	demo;
+    char*	name;			// demo, plus the layout
+    int		layout;			// -1: as is, else colmajor
+    int		tics;
+    uint64_t	wall;			// ns
+    uint64_t	scopes[NUMPROFSCOPES];	// ns
+
+    boolean	hasbase;
+    int		basetics;
+    double	basefps;
+    boolean	failed;
+} benchresult_t;
+
+static const struct
+{
+    const char*	name;
+    profscope_t	scope;
+} phases[] =
+{
+    {"sim", prof_ticker},
+    {"bsp", prof_bsp},
+    {"planes", prof_planes},
+    {"masked", prof_masked},
+    {"blit", prof_blit}
+};
+
+#define NUMPHASES	(sizeof(phases) / sizeof(phases[0]))
+
+boolean			benchmarking;
+
+static benchresult_t	results[MAXBENCHDEMOS];
+static int		numdemos;
+static int		current;
+static int		tolerance;
+
+static uint64_t		starttime;
+static int		starttic;
+
+
+//
+// M_BenchLoadBaseline
+// Picks the "bench," lines out of a file; anything else is ignored.
+//
+static void M_BenchLoadBaseline (char* filename)
+{
+    char*		data;
+    unsigned long	size;
+    unsigned long	pos;
+    int			len;
+    char		line[256];
+    char		demo[64];
+    int			tics;
+    double		wall;
+    double		fps;
+    int			i;
+
+    data = sel4doom_load_file (filename, &size);
+    if (!data)
+	I_Error ("M_BenchLoadBaseline: couldn't load %s", filename);
+
+    for (pos=0 ; pos<size ; )
+    {
+	for (len=0 ; pos<size && data[pos] != '\n' ; pos++)
+	    if (len < sizeof(line)-1)
+		line[len++] = data[pos];
+	line[len] = 0;
+	pos++;
+
+	if (sscanf (line, "bench,%63[^,],%d,%lf,%lf",
+		    demo, &tics, &wall, &fps) != 4)
+	    continue;
+
+	for (i=0 ; i<numdemos ; i++)
+	{
+	    if (strcasecmp (results[i].name, demo))
+		continue;
+	    results[i].hasbase = true;
+	    results[i].basetics = tics;
+	    results[i].basefps = fps;
+	}
+    }
+
+    for (i=0 ; i<numdemos ; i++)
+	if (!results[i].hasbase)
+	    printf ("M_BenchLoadBaseline: no baseline for %s\n",
+		    results[i].name);
+}
+
+
+//
+// M_BenchLayouts
+// Doubles the demo list, one run per view buffer layout.
+//
+static void M_BenchLayouts (void)
+{
+    int		i;
+
+    if (numdemos*2 > MAXBENCHDEMOS)
+	I_Error ("M_BenchLayouts: more than %i demos", MAXBENCHDEMOS/2);
+
+    for (i=numdemos-1 ; i>=0 ; i--)
+    {
+	results[i*2] = results[i];
+	results[i*2].layout = false;
+	results[i*2+1] = results[i];
+	results[i*2+1].layout = true;
+	results[i*2+1].name = malloc (strlen (results[i].demo) + 10);
+	if (!results[i*2+1].name)
+	    I_Error ("M_BenchLayouts: out of memory");
+	sprintf (results[i*2+1].name, "%s/colmajor", results[i].demo);
+    }
+    numdemos *= 2;
+}
+
+
+char* M_BenchInit (void)
+{
+    int		p;
+    unsigned	i;
+
+    p = M_CheckParm ("-benchmark");
+    if (!p)
+	return NULL;
+
+    // the parms after p are demo names,
+    // until end of parms or another - preceded parm
+    while (++p != myargc && myargv[p][0] != '-')
+    {
+	if (numdemos == MAXBENCHDEMOS)
+	    I_Error ("M_BenchInit: more than %i demos", MAXBENCHDEMOS);
+	results[numdemos].demo = myargv[p];
+	results[numdemos].name = myargv[p];
+	results[numdemos].layout = -1;
+	numdemos++;
+    }
+    if (!numdemos)
+	I_Error ("M_BenchInit: no demos given");
+
+    if (M_CheckParm ("-benchlayouts"))
+	M_BenchLayouts ();
+
+    tolerance = BENCHTOLERANCE;
+    p = M_CheckParm ("-benchtolerance");
+    if (p && p < myargc-1)
+	tolerance = atoi (myargv[p+1]);
+
+    p = M_CheckParm ("-benchbase");
+    if (p && p < myargc-1)
+	M_BenchLoadBaseline (myargv[p+1]);
+
+    benchmarking = true;
+    profiling = true;
+
+    printf ("bench,demo,tics,wall_ms,fps");
+    for (i=0 ; i<NUMPHASES ; i++)
+	printf (",%s_ms", phases[i].name);
+    printf (",base_fps,result\n");
+
+    return results[0].demo;
+}
+
+
+void M_BenchStart (void)
+{
+    if (results[current].layout != -1)
+	R_SetViewLayout (results[current].layout);
+
+    M_ProfileResetTotals ();
+    starttic = gametic;
+    starttime = sel4doom_get_current_time_ns ();
+}
+
+
+static double M_BenchFPS (benchresult_t* r)
+{
+    return r->wall ? r->tics * 1e9 / r->wall : 0;
+}
+
+
+static const char* M_BenchResult (benchresult_t* r)
+{
+    if (!r->hasbase)
+	return "none";
+    return r->failed ? "fail" : "pass";
+}
+
+
+//
+// M_BenchSummary
+// Prints all results as JSON and exits.
+//
+static void M_BenchSummary (void)
+{
+    benchresult_t*	r;
+    boolean		failed;
+    unsigned		i;
+    int			j;
+
+    failed = false;
+    printf ("{\"benchmark\": [\n");
+    for (j=0 ; j<numdemos ; j++)
+    {
+	r = &results[j];
+	printf ("  {\"demo\": \"%s\", \"tics\": %i, \"wall_ms\": %.3f"
+		", \"fps\": %.2f",
+		r->name, r->tics, r->wall / 1e6, M_BenchFPS (r));
+	for (i=0 ; i<NUMPHASES ; i++)
+	    printf (", \"%s_ms\": %.3f",
+		    phases[i].name, r->scopes[phases[i].scope] / 1e6);
+	if (r->hasbase)
+	    printf (", \"base_tics\": %i, \"base_fps\": %.2f",
+		    r->basetics, r->basefps);
+	printf (", \"result\": \"%s\"}%s\n",
+		M_BenchResult (r), j < numdemos-1 ? "," : "");
+	failed |= r->failed;
+    }
+    printf ("], \"tolerance\": %i, \"result\": \"%s\"}\n",
+	    tolerance, failed ? "fail" : "pass");
+    fflush (stdout);
+
+    // don't dump the profiler history on quit unless asked to
+    profiling = M_CheckParm ("-profile") != 0;
+
+    if (failed)
+	I_Error ("benchmark failed");
+    I_Quit ();
+}
+
+
+char* M_BenchNext (void)
+{
+    benchresult_t*	r;
+    double		fps;
+    unsigned		i;
+
+    r = &results[current];
+    r->wall = sel4doom_get_current_time_ns () - starttime;
+    r->tics = gametic - starttic;
+    M_ProfileTotals (r->scopes);
+
+    fps = M_BenchFPS (r);
+    if (r->hasbase)
+	r->failed = r->tics != r->basetics
+	    || fps < r->basefps * (100 - tolerance) / 100;
+
+    printf ("bench,%s,%i,%.3f,%.2f", r->name, r->tics, r->wall / 1e6, fps);
+    for (i=0 ; i<NUMPHASES ; i++)
+	printf (",%.3f", r->scopes[phases[i].scope] / 1e6);
+    if (r->hasbase)
+	printf (",%.2f", r->basefps);
+    else
+	printf (",");
+    printf (",%s\n", M_BenchResult (r));
+    fflush (stdout);
+
+    if (++current == numdemos)
+	M_BenchSummary ();	// doesn't return
+
+    return results[current].demo;
+}
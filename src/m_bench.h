@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2015, Josef Mihalits
+ *
+ * This software may be distributed and modified according to the terms of
+ * the GNU General Public License version 2. Note that NO WARRANTY is provided.
+ * See "COPYING" for details.
+ *
+ */
+
+#ifndef __M_BENCH__
+#define __M_BENCH__
+
+#include "doomtype.h"
+
+//
+// Benchmark mode: -benchmark demo1 [demo2 ...] times the demos back to
+//  back like -timedemo and prints the results to the console.
+//
+extern boolean	benchmarking;
+
+// Returns the name of the first demo, or NULL without -benchmark.
+char* M_BenchInit (void);
+
+// Called when a demo has been loaded and is about to start.
+void M_BenchStart (void);
+
+// Called at the end of a demo. Records its results and returns the
+//  name of the next demo; after the last one the summary is printed
+//  and the program exits.
+char* M_BenchNext (void);
+
+#endif
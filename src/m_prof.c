@@ -0,0 +1,266 @@
+/*
+ * Copyright (c) 2015, Josef Mihalits
+ *
+ * This software may be distributed and modified according to the terms of
+ * the GNU General Public License version 2. Note that NO WARRANTY is provided.
+ * See "COPYING" for details.
+ *
+ */
+
+/*
+ * Frame profiler.
+ *
+ * Every scope accumulates the time spent in it during the current frame
+ * (P_Ticker, for example, can run several times per frame). At the end of
+ * a frame the per-scope times are appended to a ring buffer that holds the
+ * last PROFHISTORY frames. The overlay shows min/avg/max over the last
+ * PROFWINDOW frames; M_ProfileDump prints the whole ring buffer as CSV.
+ *
+ * Times come from the TSC based timer of the root task (ns resolution).
+ *
+ * Independent of frames, every scope also adds up its time since the last
+ * M_ProfileResetTotals; the benchmark mode (m_bench.c) uses these totals.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "doomdef.h"
+#include "m_argv.h"
+#include "m_swap.h"
+#include "v_video.h"
+#include "doomstat.h"
+#include "hu_stuff.h"
+#include "sel4_doom.h"
+
+#include "m_prof.h"
+
+
+#define PROFHISTORY	1024	// frames kept for M_ProfileDump
+#define PROFWINDOW	35	// frames summarized by the overlay
+
+boolean		profiling;
+
+static const char* scopenames[NUMPROFSCOPES] =
+{
+    "frame", "bsp", "planes", "masked", "ticker", "sound", "stbar", "blit"
+};
+
+// start time of the open scopes, 0 if not open
+static uint64_t		scopestart[NUMPROFSCOPES];
+
+// time spent in each scope during the current frame
+static uint64_t		scopetime[NUMPROFSCOPES];
+
+// time spent in each scope since M_ProfileResetTotals
+static uint64_t		scopetotal[NUMPROFSCOPES];
+
+// end of the previous frame, 0 if there is none yet
+static uint64_t		lastframe;
+
+// the last PROFHISTORY frames, in ns
+static uint32_t		history[PROFHISTORY][NUMPROFSCOPES];
+static unsigned		numframes;	// frames recorded so far
+
+extern patch_t*		hu_font[HU_FONTSIZE];
+
+
+void M_ProfileInit (void)
+{
+    profiling = M_CheckParm ("-profile") != 0;
+}
+
+
+void M_ProfileToggle (void)
+{
+    profiling = !profiling;
+    lastframe = 0;
+    memset (scopestart, 0, sizeof(scopestart));
+    memset (scopetime, 0, sizeof(scopetime));
+}
+
+
+void M_ProfileStart (profscope_t scope)
+{
+    scopestart[scope] = sel4doom_get_current_time_ns ();
+}
+
+
+void M_ProfileStop (profscope_t scope)
+{
+    uint64_t	t;
+
+    if (scopestart[scope])
+    {
+	t = sel4doom_get_current_time_ns () - scopestart[scope];
+	scopetime[scope] += t;
+	scopetotal[scope] += t;
+	scopestart[scope] = 0;
+    }
+}
+
+
+void M_ProfileResetTotals (void)
+{
+    memset (scopetotal, 0, sizeof(scopetotal));
+}
+
+
+void M_ProfileTotals (uint64_t* totals)
+{
+    memcpy (totals, scopetotal, sizeof(scopetotal));
+}
+
+
+void M_ProfileFrame (void)
+{
+    uint64_t	now;
+    uint32_t*	row;
+    int		i;
+
+    if (!profiling)
+	return;
+
+    now = sel4doom_get_current_time_ns ();
+    if (lastframe)
+    {
+	scopetime[prof_frame] = now - lastframe;
+	row = history[numframes % PROFHISTORY];
+	for (i=0 ; i<NUMPROFSCOPES ; i++)
+	    row[i] = scopetime[i] > 0xffffffff ? 0xffffffff : scopetime[i];
+	numframes++;
+    }
+    lastframe = now;
+    memset (scopetime, 0, sizeof(scopetime));
+}
+
+
+//
+// M_ProfileText
+// Draws a string with the HUD font; returns the x behind it.
+//
+static int M_ProfileText (int x, int y, int xmax, const char* s)
+{
+    int		c;
+    int		w;
+
+    for ( ; *s ; s++)
+    {
+	c = toupper (*s) - HU_FONTSTART;
+	if (c < 0 || c >= HU_FONTSIZE)
+	{
+	    x += 4;
+	    continue;
+	}
+	w = SHORT (hu_font[c]->width);
+	if (x + w > xmax)
+	    break;
+	V_DrawPatchDirect (x, y, 0, hu_font[c]);
+	x += w;
+    }
+    return x;
+}
+
+
+//
+// M_ProfileDrawer
+// The overlay goes into the top left corner of the view window,
+//  which the renderer redraws every frame.
+//
+#define PROFLINE	9
+#define PROFCOL		40
+
+void M_ProfileDrawer (void)
+{
+    uint32_t	min;
+    uint32_t	max;
+    uint64_t	sum;
+    uint32_t	t;
+    unsigned	frames;
+    int		i;
+    int		j;
+    int		x;
+    int		y;
+    int		w;
+    int		h;
+    int		xmax;
+    char	buf[16];
+    uint32_t	val[3];
+
+    if (!profiling || !numframes)
+	return;
+
+    frames = numframes < PROFWINDOW ? numframes : PROFWINDOW;
+    w = 4 * PROFCOL;
+    h = (NUMPROFSCOPES + 1) * PROFLINE + 2;
+    if (w<<hires > scaledviewwidth || h<<hires > viewheight)
+	return;
+
+    // the text is drawn in ORIGWIDTH x ORIGHEIGHT coordinates
+    x = viewwindowx>>hires;
+    y = viewwindowy>>hires;
+    xmax = x + w;
+
+    // black background
+    for (j=0 ; j<h<<hires ; j++)
+	memset (screens[0] + (viewwindowy+j)*SCREENWIDTH + viewwindowx,
+		0, w<<hires);
+    V_MarkRect (viewwindowx, viewwindowy, w<<hires, h<<hires);
+
+    y++;
+    M_ProfileText (x + 2 + 1*PROFCOL, y, xmax, "min ms");
+    M_ProfileText (x + 2 + 2*PROFCOL, y, xmax, "avg");
+    M_ProfileText (x + 2 + 3*PROFCOL, y, xmax, "max");
+
+    for (i=0 ; i<NUMPROFSCOPES ; i++)
+    {
+	min = 0xffffffff;
+	max = 0;
+	sum = 0;
+	for (j=0 ; j<frames ; j++)
+	{
+	    t = history[(numframes - 1 - j) % PROFHISTORY][i];
+	    if (t < min)
+		min = t;
+	    if (t > max)
+		max = t;
+	    sum += t;
+	}
+	val[0] = min;
+	val[1] = sum / frames;
+	val[2] = max;
+
+	y += PROFLINE;
+	M_ProfileText (x + 2, y, xmax, scopenames[i]);
+	for (j=0 ; j<3 ; j++)
+	{
+	    sprintf (buf, "%u.%02u", val[j] / 1000000, val[j] / 10000 % 100);
+	    M_ProfileText (x + 2 + (j+1)*PROFCOL, y, xmax, buf);
+	}
+    }
+}
+
+
+void M_ProfileDump (void)
+{
+    unsigned	first;
+    unsigned	f;
+    int		i;
+
+    first = numframes > PROFHISTORY ? numframes - PROFHISTORY : 0;
+
+    printf ("frame");
+    for (i=0 ; i<NUMPROFSCOPES ; i++)
+	printf (",%s_ns", scopenames[i]);
+    printf ("\n");
+
+    for (f=first ; f<numframes ; f++)
+    {
+	printf ("%u", f);
+	for (i=0 ; i<NUMPROFSCOPES ; i++)
+	    printf (",%u", history[f % PROFHISTORY][i]);
+	printf ("\n");
+    }
+    fflush (stdout);
+}
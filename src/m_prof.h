@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2015, Josef Mihalits
+ *
+ * This software may be distributed and modified according to the terms of
+ * the GNU General Public License version 2. Note that NO WARRANTY is provided.
+ * See "COPYING" for details.
+ *
+ */
+
+#ifndef __M_PROF__
+#define __M_PROF__
+
+#include <stdint.h>
+
+#include "doomtype.h"
+
+//
+// Frame profiler. Enabled with -profile or the "prof" cheat;
+//  the "csv" cheat dumps the recorded frames to the console.
+//
+typedef enum
+{
+    prof_frame,		// whole frame, see M_ProfileFrame
+    prof_bsp,		// R_RenderBSPNode
+    prof_planes,	// R_DrawPlanes
+    prof_masked,	// R_DrawMasked
+    prof_ticker,	// P_Ticker
+    prof_sound,		// S_UpdateSounds
+    prof_stbar,		// ST_Drawer
+    prof_blit,		// I_FinishUpdate
+    NUMPROFSCOPES
+} profscope_t;
+
+extern boolean	profiling;
+
+#define PROF_START(s)	do { if (profiling) M_ProfileStart (s); } while (0)
+#define PROF_STOP(s)	do { if (profiling) M_ProfileStop (s); } while (0)
+
+void M_ProfileInit (void);
+void M_ProfileToggle (void);
+
+void M_ProfileStart (profscope_t scope);
+void M_ProfileStop (profscope_t scope);
+
+// Time spent in each scope since the last reset, in ns;
+//  "totals" has NUMPROFSCOPES entries.
+void M_ProfileResetTotals (void);
+void M_ProfileTotals (uint64_t* totals);
+
+// Closes the current frame; call once per D_Display.
+void M_ProfileFrame (void);
+
+// Draws min/avg/max of the last frames into screens[0].
+void M_ProfileDrawer (void);
+
+// Prints all recorded frames as CSV.
+void M_ProfileDump (void);
+
+#endif
@@ -29,6 +29,7 @@ rcsid[] = "$Id: p_enemy.c,v 1.5 1997/02/03 22:45:11 b1 Exp $";
 #include <stdlib.h>
 
 #include "m_random.h"
+#include "m_bbox.h"
 #include "i_system.h"
 
 #include "doomdef.h"
@@ -1173,6 +1174,7 @@ void A_VileChase (mobj_t* actor)
     
     int			bx;
     int			by;
+    fixed_t		box[4];
 
     mobjinfo_t*		info;
     mobj_t*		temp;
@@ -1185,10 +1187,14 @@ void A_VileChase (mobj_t* actor)
 	viletryy =
 	    actor->y + actor->info->speed*yspeed[actor->movedir];
 
-	xl = (viletryx - bmaporgx - MAXRADIUS*2)>>MAPBLOCKSHIFT;
-	xh = (viletryx - bmaporgx + MAXRADIUS*2)>>MAPBLOCKSHIFT;
-	yl = (viletryy - bmaporgy - MAXRADIUS*2)>>MAPBLOCKSHIFT;
-	yh = (viletryy - bmaporgy + MAXRADIUS*2)>>MAPBLOCKSHIFT;
+	box[BOXTOP] = viletryy + MAXRADIUS*2;
+	box[BOXBOTTOM] = viletryy - MAXRADIUS*2;
+	box[BOXRIGHT] = viletryx + MAXRADIUS*2;
+	box[BOXLEFT] = viletryx - MAXRADIUS*2;
+	xl = (box[BOXLEFT] - bmaporgx)>>MAPBLOCKSHIFT;
+	xh = (box[BOXRIGHT] - bmaporgx)>>MAPBLOCKSHIFT;
+	yl = (box[BOXBOTTOM] - bmaporgy)>>MAPBLOCKSHIFT;
+	yh = (box[BOXTOP] - bmaporgy)>>MAPBLOCKSHIFT;
 	
 	vileobj = actor;
 	for (bx=xl ; bx<=xh ; bx++)
@@ -1198,7 +1204,7 @@ void A_VileChase (mobj_t* actor)
 		// Call PIT_VileCheck to check
 		// whether object is a corpse
 		// that canbe raised.
-		if (!P_BlockThingsIterator(bx,by,PIT_VileCheck))
+		if (!P_BlockThingsIteratorBox(bx,by,box,PIT_VileCheck))
 		{
 		    // got one!
 		    temp = actor->target;
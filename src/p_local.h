@@ -41,6 +41,11 @@
 #define MAPBMASK		(MAPBLOCKSIZE-1)
 #define MAPBTOFRAC		(MAPBLOCKSHIFT-FRACBITS)
 
+// the fine thing grid splits each mapblock
+// into FINETHINGS*FINETHINGS cells of 64 units
+#define FINETHINGS		2
+#define FINETHINGSHIFT	(MAPBLOCKSHIFT-1)
+
 
 // player radius for movement checking
 #define PLAYERRADIUS	16*FRACUNIT
@@ -70,7 +75,37 @@
 extern	thinker_t	thinkercap;	
 
 
+// thinker pools, see P_AllocThinker
+typedef enum
+{
+    tp_mobjs,
+    tp_lights,		// fireflicker_t, lightflash_t, strobe_t, glow_t
+    tp_movers,		// doors, plats, ceilings, floors
+    NUMTHINKERPOOLS
+} thinkerpool_t;
+
+// What P_AllocThinker puts in front of every thinker. The links
+//  of mobjs in the fine thing grid are kept here, out of mobj_t,
+//  so savegames keep their format; see P_SetThingPosition.
+typedef struct thinkerhead_s
+{
+    union
+    {
+	struct tpool_s*		pool;		// in use, NULL: zone block
+	struct thinkerhead_s*	nextfree;	// free
+    } u;
+    mobj_t*		fnext;
+    mobj_t*		fprev;
+    unsigned		linkstamp;	// higher: linked later
+} thinkerhead_t;
+
+#define FINELINK(mo)	((thinkerhead_t *)(mo) - 1)
+
 void P_InitThinkers (void);
+void P_ClearThinkerPools (void);
+void* P_AllocThinker (thinkerpool_t pool, int size);
+void P_FreeThinker (thinker_t* thinker);
+void P_DropThinker (thinker_t* thinker);
 void P_AddThinker (thinker_t* thinker);
 void P_RemoveThinker (thinker_t* thinker);
 
@@ -104,8 +139,15 @@ extern int		iquehead;
 extern int		iquetail;
 
 
+// mobjs allocated per type; mobjlive is reset with the level
+extern int		mobjspawned[NUMMOBJTYPES];
+extern int		mobjlive[NUMMOBJTYPES];
+extern int		mobjpeak[NUMMOBJTYPES];
+
 void P_RespawnSpecials (void);
 
+mobj_t* P_AllocMobj (mobjtype_t type);
+
 mobj_t*
 P_SpawnMobj
 ( fixed_t	x,
@@ -151,9 +193,10 @@ typedef struct
     }			d;
 } intercept_t;
 
+// initial size of intercepts[], which grows on demand
 #define MAXINTERCEPTS	128
 
-extern intercept_t	intercepts[MAXINTERCEPTS];
+extern intercept_t*	intercepts;
 extern intercept_t*	intercept_p;
 
 typedef boolean (*traverser_t) (intercept_t *in);
@@ -174,6 +217,14 @@ void 	P_LineOpening (line_t* linedef);
 
 boolean P_BlockLinesIterator (int x, int y, boolean(*func)(line_t*) );
 boolean P_BlockThingsIterator (int x, int y, boolean(*func)(mobj_t*) );
+boolean
+P_BlockThingsIteratorBox
+( int		x,
+  int		y,
+  fixed_t*	box,
+  boolean	(*func)(mobj_t*) );
+
+void P_ThingGridBench (void);
 
 #define PT_ADDLINES		1
 #define PT_ADDTHINGS	2
@@ -244,13 +295,19 @@ P_RadiusAttack
 // P_SETUP
 //
 extern byte*		rejectmatrix;	// for fast sight rejection
-extern short*		blockmaplump;	// offsets in blockmap are from here
-extern short*		blockmap;
+extern int*		blockmap;	// offsets into blocklists
+extern int*		blocklists;	// line numbers, -1 terminated
+extern byte*		blockempty;	// bit set: no lines in mapblock
+extern boolean		blockzero;	// check line 0 for every mapblock
 extern int		bmapwidth;
 extern int		bmapheight;	// in mapblocks
 extern fixed_t		bmaporgx;
 extern fixed_t		bmaporgy;	// origin of block map
 extern mobj_t**		blocklinks;	// for thing chains
+extern mobj_t**		finelinks;	// thing chains per fine cell
+extern int		finewidth;	// in fine cells
+extern unsigned short*	bigthings;	// per mapblock, see P_SetThingPosition
+extern boolean		finethings;
 
 
 
@@ -123,6 +123,7 @@ P_TeleportMove
     int			yh;
     int			bx;
     int			by;
+    fixed_t		box[4];
     
     subsector_t*	newsubsec;
     
@@ -152,14 +153,18 @@ P_TeleportMove
     numspechit = 0;
     
     // stomp on any things contacted
-    xl = (tmbbox[BOXLEFT] - bmaporgx - MAXRADIUS)>>MAPBLOCKSHIFT;
-    xh = (tmbbox[BOXRIGHT] - bmaporgx + MAXRADIUS)>>MAPBLOCKSHIFT;
-    yl = (tmbbox[BOXBOTTOM] - bmaporgy - MAXRADIUS)>>MAPBLOCKSHIFT;
-    yh = (tmbbox[BOXTOP] - bmaporgy + MAXRADIUS)>>MAPBLOCKSHIFT;
+    box[BOXTOP] = tmbbox[BOXTOP] + MAXRADIUS;
+    box[BOXBOTTOM] = tmbbox[BOXBOTTOM] - MAXRADIUS;
+    box[BOXRIGHT] = tmbbox[BOXRIGHT] + MAXRADIUS;
+    box[BOXLEFT] = tmbbox[BOXLEFT] - MAXRADIUS;
+    xl = (box[BOXLEFT] - bmaporgx)>>MAPBLOCKSHIFT;
+    xh = (box[BOXRIGHT] - bmaporgx)>>MAPBLOCKSHIFT;
+    yl = (box[BOXBOTTOM] - bmaporgy)>>MAPBLOCKSHIFT;
+    yh = (box[BOXTOP] - bmaporgy)>>MAPBLOCKSHIFT;
 
     for (bx=xl ; bx<=xh ; bx++)
 	for (by=yl ; by<=yh ; by++)
-	    if (!P_BlockThingsIterator(bx,by,PIT_StompThing))
+	    if (!P_BlockThingsIteratorBox(bx,by,box,PIT_StompThing))
 		return false;
     
     // the move is ok,
@@ -383,6 +388,7 @@ P_CheckPosition
     int			yh;
     int			bx;
     int			by;
+    fixed_t		box[4];
     subsector_t*	newsubsec;
 
     tmthing = thing;
@@ -417,14 +423,18 @@ P_CheckPosition
     // because mobj_ts are grouped into mapblocks
     // based on their origin point, and can overlap
     // into adjacent blocks by up to MAXRADIUS units.
-    xl = (tmbbox[BOXLEFT] - bmaporgx - MAXRADIUS)>>MAPBLOCKSHIFT;
-    xh = (tmbbox[BOXRIGHT] - bmaporgx + MAXRADIUS)>>MAPBLOCKSHIFT;
-    yl = (tmbbox[BOXBOTTOM] - bmaporgy - MAXRADIUS)>>MAPBLOCKSHIFT;
-    yh = (tmbbox[BOXTOP] - bmaporgy + MAXRADIUS)>>MAPBLOCKSHIFT;
+    box[BOXTOP] = tmbbox[BOXTOP] + MAXRADIUS;
+    box[BOXBOTTOM] = tmbbox[BOXBOTTOM] - MAXRADIUS;
+    box[BOXRIGHT] = tmbbox[BOXRIGHT] + MAXRADIUS;
+    box[BOXLEFT] = tmbbox[BOXLEFT] - MAXRADIUS;
+    xl = (box[BOXLEFT] - bmaporgx)>>MAPBLOCKSHIFT;
+    xh = (box[BOXRIGHT] - bmaporgx)>>MAPBLOCKSHIFT;
+    yl = (box[BOXBOTTOM] - bmaporgy)>>MAPBLOCKSHIFT;
+    yh = (box[BOXTOP] - bmaporgy)>>MAPBLOCKSHIFT;
 
     for (bx=xl ; bx<=xh ; bx++)
 	for (by=yl ; by<=yh ; by++)
-	    if (!P_BlockThingsIterator(bx,by,PIT_CheckThing))
+	    if (!P_BlockThingsIteratorBox(bx,by,box,PIT_CheckThing))
 		return false;
     
     // check lines
@@ -1218,18 +1228,28 @@ P_RadiusAttack
     
     fixed_t	dist;
 	
+    fixed_t	box[4];
+	
     dist = (damage+MAXRADIUS)<<FRACBITS;
     yh = (spot->y + dist - bmaporgy)>>MAPBLOCKSHIFT;
     yl = (spot->y - dist - bmaporgy)>>MAPBLOCKSHIFT;
     xh = (spot->x + dist - bmaporgx)>>MAPBLOCKSHIFT;
     xl = (spot->x - dist - bmaporgx)>>MAPBLOCKSHIFT;
+
+    // MAXRADIUS shifts out of dist above, so the blocks only
+    //  reach damage units; but PIT_RadiusAttack hits things
+    //  up to damage plus their radius away.
+    box[BOXTOP] = spot->y + dist + MAXRADIUS;
+    box[BOXBOTTOM] = spot->y - dist - MAXRADIUS;
+    box[BOXRIGHT] = spot->x + dist + MAXRADIUS;
+    box[BOXLEFT] = spot->x - dist - MAXRADIUS;
     bombspot = spot;
     bombsource = source;
     bombdamage = damage;
 	
     for (y=yl ; y<=yh ; y++)
 	for (x=xl ; x<=xh ; x++)
-	    P_BlockThingsIterator (x, y, PIT_RadiusAttack );
+	    P_BlockThingsIteratorBox (x, y, box, PIT_RadiusAttack );
 }
 
 
@@ -28,13 +28,17 @@ static const char
 rcsid[] = "$Id: p_maputl.c,v 1.5 1997/02/03 22:45:11 b1 Exp $";
 
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 
 #include "m_bbox.h"
+#include "z_zone.h"
 
 #include "doomdef.h"
 #include "p_local.h"
+#include "sel4_doom.h"
 
 
 // State.
@@ -337,6 +341,79 @@ void P_LineOpening (line_t* linedef)
 //
 
 
+//
+// FINE THING GRID
+// With -finethings, every thing in blocklinks is also linked into
+// the chain of the 64 unit cell its origin is in. Both chains are
+// built by linking at the head, so the things of a block, newest
+// first, are the things of its cells merged by descending linkstamp.
+//
+static unsigned		linkstamp;
+
+// Wider than MAXRADIUS, so its block is searched whole. This goes
+// by the spawn radius: a crushed corpse has radius 0, but
+// PIT_VileCheck still reaches it by its info radius.
+#define BIGTHING(mo)	(mobjinfo[(mo)->type].radius > MAXRADIUS)
+
+
+//
+// P_LinkFineThing
+// The thing is in the blockmap.
+//
+static void P_LinkFineThing (mobj_t* thing)
+{
+    thinkerhead_t*	head;
+    mobj_t**		link;
+    int			cellx;
+    int			celly;
+
+    cellx = (thing->x - bmaporgx)>>FINETHINGSHIFT;
+    celly = (thing->y - bmaporgy)>>FINETHINGSHIFT;
+
+    head = FINELINK(thing);
+    link = &finelinks[celly*finewidth+cellx];
+    head->fprev = NULL;
+    head->fnext = *link;
+    if (*link)
+	FINELINK(*link)->fprev = thing;
+
+    *link = thing;
+    head->linkstamp = ++linkstamp;
+
+    if (BIGTHING(thing))
+	bigthings[(celly/FINETHINGS)*bmapwidth+cellx/FINETHINGS]++;
+}
+
+
+static void P_UnlinkFineThing (mobj_t* thing)
+{
+    thinkerhead_t*	head;
+    int			cellx;
+    int			celly;
+
+    cellx = (thing->x - bmaporgx)>>FINETHINGSHIFT;
+    celly = (thing->y - bmaporgy)>>FINETHINGSHIFT;
+
+    // off the map, so never linked
+    if (cellx<0 || cellx>=finewidth
+	|| celly<0 || celly>=bmapheight*FINETHINGS)
+	return;
+
+    head = FINELINK(thing);
+    if (head->fnext)
+	FINELINK(head->fnext)->fprev = head->fprev;
+
+    if (head->fprev)
+	FINELINK(head->fprev)->fnext = head->fnext;
+    else
+	finelinks[celly*finewidth+cellx] = head->fnext;
+
+    if (BIGTHING(thing))
+	bigthings[(celly/FINETHINGS)*bmapwidth+cellx/FINETHINGS]--;
+}
+
+
+
 //
 // P_UnsetThingPosition
 // Unlinks a thing from block map and sectors.
@@ -382,6 +459,9 @@ void P_UnsetThingPosition (mobj_t* thing)
 		blocklinks[blocky*bmapwidth+blockx] = thing->bnext;
 	    }
 	}
+
+	if (finethings)
+	    P_UnlinkFineThing (thing);
     }
 }
 
@@ -440,6 +520,9 @@ P_SetThingPosition (mobj_t* thing)
 		(*link)->bprev = thing;
 
 	    *link = thing;
+
+	    if (finethings)
+		P_LinkFineThing (thing);
 	}
 	else
 	{
@@ -475,7 +558,7 @@ P_BlockLinesIterator
   boolean(*func)(line_t*) )
 {
     int			offset;
-    short*		list;
+    int*		list;
     line_t*		ld;
 	
     if (x<0
@@ -487,10 +570,19 @@ P_BlockLinesIterator
     }
     
     offset = y*bmapwidth+x;
-	
-    offset = *(blockmap+offset);
 
-    for ( list = blockmaplump+offset ; *list != -1 ; list++)
+    // the node builders put line 0 first in every list
+    if (blockzero && lines->validcount != validcount)
+    {
+	lines->validcount = validcount;
+	if ( !func(lines) )
+	    return false;
+    }
+
+    if (blockempty[offset>>3] & (1<<(offset&7)))
+	return true;
+
+    for ( list = blocklists+blockmap[offset] ; *list != -1 ; list++)
     {
 	ld = &lines[*list];
 
@@ -537,17 +629,294 @@ P_BlockThingsIterator
 }
 
 
+//
+// P_BlockThingsIteratorBox
+// Same as P_BlockThingsIterator, for a func that returns true
+// without side effects for any thing whose origin is outside
+// box, as long as the thing is no wider than MAXRADIUS. So box
+// is what func can reach, padded by MAXRADIUS.
+// The things of the block in the cells touching box are visited
+// in blocklinks order, so demos stay in sync.
+//
+boolean
+P_BlockThingsIteratorBox
+( int		x,
+  int		y,
+  fixed_t*	box,
+  boolean	(*func)(mobj_t*) )
+{
+    mobj_t*	cells[FINETHINGS*FINETHINGS];
+    unsigned	stamps[FINETHINGS*FINETHINGS];
+    mobj_t*	mobj;
+    int		numcells;
+    int		best;
+    int		i;
+    int		cx;
+    int		cy;
+    int		cxl;
+    int		cxh;
+    int		cyl;
+    int		cyh;
+
+    if ( x<0
+	 || y<0
+	 || x>=bmapwidth
+	 || y>=bmapheight)
+    {
+	return true;
+    }
+
+    // nothing to filter, or a wide thing can be hit from outside box
+    mobj = blocklinks[y*bmapwidth+x];
+    if (!mobj)
+	return true;
+    if (!mobj->bnext || !finethings || bigthings[y*bmapwidth+x])
+	return P_BlockThingsIterator (x, y, func);
+
+    cxl = (box[BOXLEFT] - bmaporgx)>>FINETHINGSHIFT;
+    cxh = (box[BOXRIGHT] - bmaporgx)>>FINETHINGSHIFT;
+    cyl = (box[BOXBOTTOM] - bmaporgy)>>FINETHINGSHIFT;
+    cyh = (box[BOXTOP] - bmaporgy)>>FINETHINGSHIFT;
+
+    if (cxl < x*FINETHINGS)
+	cxl = x*FINETHINGS;
+    if (cxh > x*FINETHINGS+FINETHINGS-1)
+	cxh = x*FINETHINGS+FINETHINGS-1;
+    if (cyl < y*FINETHINGS)
+	cyl = y*FINETHINGS;
+    if (cyh > y*FINETHINGS+FINETHINGS-1)
+	cyh = y*FINETHINGS+FINETHINGS-1;
+
+    if (cxl > cxh || cyl > cyh)
+	return true;
+
+    // box covers the whole block
+    if ((cxh-cxl+1)*(cyh-cyl+1) == FINETHINGS*FINETHINGS)
+	return P_BlockThingsIterator (x, y, func);
+
+    numcells = 0;
+    for (cy=cyl ; cy<=cyh ; cy++)
+	for (cx=cxl ; cx<=cxh ; cx++)
+	    if ( (mobj = finelinks[cy*finewidth+cx]) )
+	    {
+		stamps[numcells] = FINELINK(mobj)->linkstamp;
+		cells[numcells++] = mobj;
+	    }
+
+    // merge the cells, newest first
+    while (numcells > 1)
+    {
+	best = 0;
+	for (i=1 ; i<numcells ; i++)
+	    if ((int)(stamps[i] - stamps[best]) > 0)
+		best = i;
+
+	mobj = cells[best];
+	if (!func( mobj ) )
+	    return false;
+
+	// like P_BlockThingsIterator, read the link after func
+	mobj = FINELINK(mobj)->fnext;
+	if (mobj)
+	{
+	    cells[best] = mobj;
+	    stamps[best] = FINELINK(mobj)->linkstamp;
+	}
+	else
+	{
+	    numcells--;
+	    cells[best] = cells[numcells];
+	    stamps[best] = stamps[numcells];
+	}
+    }
+
+    mobj = numcells ? cells[0] : NULL;
+    for ( ; mobj ; mobj = FINELINK(mobj)->fnext)
+    {
+	if (!func( mobj ) )
+	    return false;
+    }
+    return true;
+}
+
+
+//
+// P_ThingGridBench
+// "-thingbench" (implies -finethings) links 500 monsters at random
+// spots of the level, then times P_CheckPosition sized queries next
+// to them through the blocks and through the fine grid, and checks
+// they visit the same things in the same order. Uses its own random
+// numbers, so it runs before demos without desyncing them.
+//
+#define BENCHTHINGS	500
+#define BENCHQUERIES	100000
+
+static fixed_t		benchx;
+static fixed_t		benchy;
+static unsigned		benchsum;
+static int		benchhits;
+
+static boolean PIT_BenchThing (mobj_t* thing)
+{
+    fixed_t	blockdist;
+
+    blockdist = thing->radius + 20*FRACUNIT;
+    if ( abs(thing->x - benchx) >= blockdist
+	 || abs(thing->y - benchy) >= blockdist )
+	return true;
+
+    benchsum = benchsum*31 + FINELINK(thing)->linkstamp;
+    benchhits++;
+    return true;
+}
+
+
+static void
+P_BenchQueries
+( mobj_t**	things,
+  boolean	fine,
+  unsigned*	sum,
+  int*		hits,
+  uint64_t*	ns )
+{
+    fixed_t	box[4];
+    mobj_t*	mo;
+    unsigned	seed;
+    uint64_t	start;
+    int		i;
+    int		bx;
+    int		by;
+    int		xl;
+    int		xh;
+    int		yl;
+    int		yh;
+
+    seed = 1;
+    benchsum = 0;
+    benchhits = 0;
+    start = sel4doom_get_current_time_ns ();
+    for (i=0 ; i<BENCHQUERIES ; i++)
+    {
+	// a monster trying to move
+	seed = seed*1103515245 + 12345;
+	mo = things[(seed>>8)%BENCHTHINGS];
+	seed = seed*1103515245 + 12345;
+	benchx = mo->x + ((int)(seed>>8)%17 - 8)*FRACUNIT;
+	benchy = mo->y + ((int)(seed>>16)%17 - 8)*FRACUNIT;
+
+	box[BOXTOP] = benchy + 20*FRACUNIT + MAXRADIUS;
+	box[BOXBOTTOM] = benchy - 20*FRACUNIT - MAXRADIUS;
+	box[BOXRIGHT] = benchx + 20*FRACUNIT + MAXRADIUS;
+	box[BOXLEFT] = benchx - 20*FRACUNIT - MAXRADIUS;
+
+	xl = (box[BOXLEFT] - bmaporgx)>>MAPBLOCKSHIFT;
+	xh = (box[BOXRIGHT] - bmaporgx)>>MAPBLOCKSHIFT;
+	yl = (box[BOXBOTTOM] - bmaporgy)>>MAPBLOCKSHIFT;
+	yh = (box[BOXTOP] - bmaporgy)>>MAPBLOCKSHIFT;
+
+	for (bx=xl ; bx<=xh ; bx++)
+	    for (by=yl ; by<=yh ; by++)
+		if (fine)
+		    P_BlockThingsIteratorBox (bx, by, box, PIT_BenchThing);
+		else
+		    P_BlockThingsIterator (bx, by, PIT_BenchThing);
+    }
+    *ns = sel4doom_get_current_time_ns () - start;
+    *sum = benchsum;
+    *hits = benchhits;
+}
+
+
+void P_ThingGridBench (void)
+{
+    static mobj_t*	things[BENCHTHINGS];
+    mobj_t*	mo;
+    unsigned	seed;
+    unsigned	sum[2];
+    int		hits[2];
+    uint64_t	ns[2];
+    int		i;
+
+    // imp sized, and only in the blockmap, so not drawn;
+    // from the pool, which keeps their fine grid links
+    seed = 2;
+    for (i=0 ; i<BENCHTHINGS ; i++)
+    {
+	mo = things[i] = P_AllocThinker (tp_mobjs, sizeof(*mo));
+	memset (mo, 0, sizeof(*mo));
+	seed = seed*1103515245 + 12345;
+	mo->x = bmaporgx + (seed>>8)%(bmapwidth*MAPBLOCKUNITS)*FRACUNIT;
+	seed = seed*1103515245 + 12345;
+	mo->y = bmaporgy + (seed>>8)%(bmapheight*MAPBLOCKUNITS)*FRACUNIT;
+	mo->type = MT_TROOP;
+	mo->radius = 20*FRACUNIT;
+	mo->flags = MF_SOLID|MF_SHOOTABLE|MF_NOSECTOR;
+	P_SetThingPosition (mo);
+    }
+
+    P_BenchQueries (things, false, &sum[0], &hits[0], &ns[0]);
+    P_BenchQueries (things, true, &sum[1], &hits[1], &ns[1]);
+
+    printf ("P_ThingGridBench: %i things, %i queries: "
+	    "blocks %.3f ms, fine grid %.3f ms, %i hits, order %s\n",
+	    BENCHTHINGS, BENCHQUERIES, ns[0] / 1e6, ns[1] / 1e6,
+	    hits[0], sum[0] == sum[1] && hits[0] == hits[1]
+	    ? "matches" : "DIFFERS");
+
+    for (i=0 ; i<BENCHTHINGS ; i++)
+    {
+	P_UnsetThingPosition (things[i]);
+	P_DropThinker (&things[i]->thinker);
+    }
+}
+
+
 
 //
 // INTERCEPT ROUTINES
 //
-intercept_t	intercepts[MAXINTERCEPTS];
+// intercepts[] doubles in size when it is full; the fixed array
+//  of the original overran into the globals after it on long traces.
+intercept_t*	intercepts;
 intercept_t*	intercept_p;
 
+static int		maxintercepts;	// size of intercepts[]
+static intercept_t**	interceptheap;	// as big, see P_TraverseIntercepts
+
 divline_t 	trace;
 boolean 	earlyout;
 int		ptflags;
 
+//
+// P_CheckIntercepts
+// Makes room for one more intercept.
+//
+static void P_CheckIntercepts (void)
+{
+    intercept_t*	newintercepts;
+    int			used;
+
+    if (intercept_p < intercepts + maxintercepts)
+	return;
+
+    used = intercept_p - intercepts;
+    maxintercepts = maxintercepts ? maxintercepts*2 : MAXINTERCEPTS;
+    newintercepts = Z_Malloc (maxintercepts*sizeof(*newintercepts),
+			      PU_STATIC, NULL);
+    if (intercepts)
+    {
+	memcpy (newintercepts, intercepts, used*sizeof(*newintercepts));
+	Z_Free (intercepts);
+	Z_Free (interceptheap);
+    }
+    interceptheap = Z_Malloc (maxintercepts*sizeof(*interceptheap),
+			      PU_STATIC, NULL);
+
+    intercepts = newintercepts;
+    intercept_p = intercepts + used;
+}
+
+
 //
 // PIT_AddLineIntercepts.
 // Looks for lines in the given block
@@ -600,6 +969,7 @@ PIT_AddLineIntercepts (line_t* ld)
     }
     
 	
+    P_CheckIntercepts ();
     intercept_p->frac = frac;
     intercept_p->isaline = true;
     intercept_p->d.line = ld;
@@ -665,6 +1035,7 @@ boolean PIT_AddThingIntercepts (mobj_t* thing)
     if (frac < 0)
 	return true;		// behind source
 
+    P_CheckIntercepts ();
     intercept_p->frac = frac;
     intercept_p->isaline = false;
     intercept_p->d.thing = thing;
@@ -674,10 +1045,44 @@ boolean PIT_AddThingIntercepts (mobj_t* thing)
 }
 
 
+//
+// P_SiftIntercept
+// Moves heap[i] down the min-heap of "count" intercepts.
+//  Of equal fracs, the one added first comes first, as
+//  in the original linear search for the smallest frac.
+//
+#define InterceptBefore(a,b) \
+	((a)->frac < (b)->frac || ((a)->frac == (b)->frac && (a) < (b)))
+
+static void
+P_SiftIntercept
+( intercept_t**	heap,
+  int		count,
+  int		i )
+{
+    intercept_t*	in;
+    int			child;
+
+    in = heap[i];
+    while ((child = i*2+1) < count)
+    {
+	if (child+1 < count && InterceptBefore (heap[child+1], heap[child]))
+	    child++;
+	if (!InterceptBefore (heap[child], in))
+	    break;
+	heap[i] = heap[child];
+	i = child;
+    }
+    heap[i] = in;
+}
+
+
 //
 // P_TraverseIntercepts
 // Returns true if the traverser function returns true
 // for all lines.
+// The intercepts are taken off a heap in order of frac, so a
+//  trace that stops early doesn't sort all of them.
 // 
 boolean
 P_TraverseIntercepts
@@ -685,45 +1090,28 @@ P_TraverseIntercepts
   fixed_t	maxfrac )
 {
     int			count;
-    fixed_t		dist;
-    intercept_t*	scan;
+    int			i;
     intercept_t*	in;
 	
     count = intercept_p - intercepts;
-    
-    in = 0;			// shut up compiler warning
+
+    for (i=0 ; i<count ; i++)
+	interceptheap[i] = &intercepts[i];
+    for (i=count/2-1 ; i>=0 ; i--)
+	P_SiftIntercept (interceptheap, count, i);
 	
-    while (count--)
+    while (count)
     {
-	dist = MAXINT;
-	for (scan = intercepts ; scan<intercept_p ; scan++)
-	{
-	    if (scan->frac < dist)
-	    {
-		dist = scan->frac;
-		in = scan;
-	    }
-	}
+	in = interceptheap[0];
 	
-	if (dist > maxfrac)
+	if (in->frac > maxfrac)
 	    return true;	// checked everything in range		
 
-#if 0  // UNUSED
-    {
-	// don't check these yet, there may be others inserted
-	in = scan = intercepts;
-	for ( scan = intercepts ; scan<intercept_p ; scan++)
-	    if (scan->frac > maxfrac)
-		*in++ = *scan;
-	intercept_p = in;
-	return false;
-    }
-#endif
-
         if ( !func (in) )
 	    return false;	// don't bother going farther
 
-	in->frac = MAXINT;
+	interceptheap[0] = interceptheap[--count];
+	P_SiftIntercept (interceptheap, count, 0);
     }
 	
     return true;		// everything was traversed
@@ -473,6 +473,25 @@ void P_MobjThinker (mobj_t* mobj)
 }
 
 
+//
+// P_AllocMobj
+// Takes a mobj from the mobj pool (see P_AllocThinker)
+//  and counts it for -mobjstats.
+//
+int		mobjspawned[NUMMOBJTYPES];
+int		mobjlive[NUMMOBJTYPES];
+int		mobjpeak[NUMMOBJTYPES];
+
+mobj_t* P_AllocMobj (mobjtype_t type)
+{
+    mobjspawned[type]++;
+    if (++mobjlive[type] > mobjpeak[type])
+	mobjpeak[type] = mobjlive[type];
+
+    return P_AllocThinker (tp_mobjs, sizeof(mobj_t));
+}
+
+
 //
 // P_SpawnMobj
 //
@@ -487,7 +506,7 @@ P_SpawnMobj
     state_t*	st;
     mobjinfo_t*	info;
 	
-    mobj = Z_Malloc (sizeof(*mobj), PU_LEVEL, NULL);
+    mobj = P_AllocMobj (type);
     memset (mobj, 0, sizeof (*mobj));
     info = &mobjinfo[type];
 	
@@ -565,6 +584,8 @@ void P_RemoveMobj (mobj_t* mobj)
     // stop any playing sound
     S_StopSound (mobj);
     
+    mobjlive[mobj->type]--;
+
     // free block
     P_RemoveThinker ((thinker_t*)mobj);
 }
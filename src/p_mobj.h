@@ -227,6 +227,7 @@ typedef struct mobj_s
     // Links in blocks (if needed).
     struct mobj_s*	bnext;
     struct mobj_s*	bprev;
+
     
     struct subsector_s*	subsector;
 
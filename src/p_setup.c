@@ -27,11 +27,14 @@ rcsid[] = "$Id: p_setup.c,v 1.5 1997/02/03 22:45:12 b1 Exp $";
 
 
 #include <math.h>
+#include <stdio.h>
+#include <stdint.h>
 
 #include "z_zone.h"
 
 #include "m_swap.h"
 #include "m_bbox.h"
+#include "m_argv.h"
 
 #include "g_game.h"
 
@@ -44,6 +47,7 @@ rcsid[] = "$Id: p_setup.c,v 1.5 1997/02/03 22:45:12 b1 Exp $";
 #include "s_sound.h"
 
 #include "doomstat.h"
+#include "sel4_doom.h"
 
 
 void	P_SpawnMapThing (mapthing_t*	mthing);
@@ -85,14 +89,21 @@ side_t*		sides;
 // Blockmap size.
 int		bmapwidth;
 int		bmapheight;	// size in mapblocks
-short*		blockmap;	// int for larger maps
-// offsets in blockmap are from here
-short*		blockmaplump;		
+int*		blockmap;	// offsets into blocklists
+int*		blocklists;	// line numbers, -1 terminated
+byte*		blockempty;	// bit set: no lines in mapblock
+boolean		blockzero;	// check line 0 for every mapblock
 // origin of block map
 fixed_t		bmaporgx;
 fixed_t		bmaporgy;
 // for thing chains
 mobj_t**	blocklinks;		
+// the same chains, split by fine cell
+mobj_t**	finelinks;
+int		finewidth;
+// things wider than MAXRADIUS, per mapblock
+unsigned short*	bigthings;
+boolean		finethings;
 
 
 // REJECT
@@ -303,6 +314,7 @@ void P_LoadThings (int lump)
     byte*		data;
     int			i;
     mapthing_t*		mt;
+    mapthing_t		spawnthing;
     int			numthings;
     boolean		spawn;
 	
@@ -337,13 +349,14 @@ void P_LoadThings (int lump)
 	    break;
 
 	// Do spawn all other stuff. 
-	mt->x = SHORT(mt->x);
-	mt->y = SHORT(mt->y);
-	mt->angle = SHORT(mt->angle);
-	mt->type = SHORT(mt->type);
-	mt->options = SHORT(mt->options);
+	// (The lump may be read-only, so swap into a copy.)
+	spawnthing.x = SHORT(mt->x);
+	spawnthing.y = SHORT(mt->y);
+	spawnthing.angle = SHORT(mt->angle);
+	spawnthing.type = SHORT(mt->type);
+	spawnthing.options = SHORT(mt->options);
 	
-	P_SpawnMapThing (mt);
+	P_SpawnMapThing (&spawnthing);
     }
 	
     Z_Free (data);
@@ -463,30 +476,407 @@ void P_LoadSideDefs (int lump)
 }
 
 
+//
+// BLOCKMAP LOADING
+// The BLOCKMAP lump holds 16 bit offsets and line numbers, which
+// big maps overflow, and its lists may name a line more than once.
+// It is copied into 32 bit lists without the duplicates; blocks
+// without lines only get a bit in blockempty. The node builders
+// start every list with line 0, so the original engine checks it
+// for every block; blockzero keeps that without storing the 0 in
+// every list. Otherwise the lists keep the order of the lump, as
+// the order the lines are checked in can change what happens in
+// a demo.
+//
+// A missing, overflowed, or broken lump (or "-blockmap") is rebuilt
+// from the linedefs instead, with the lines of each list in
+// ascending order. "-blockmapbench" times both for every level.
+//
+static int	blocklistsize;	// entries in blocklists
+static int	emptyblocks;
+
+
+static void P_FreeBlockMap (void)
+{
+    Z_Free (blockmap);
+    Z_Free (blocklists);
+    Z_Free (blockempty);
+}
+
+
+//
+// P_AllocBlockMap
+// Sets up blockmap, blockempty (all set), and blocklists with a
+// shared empty list at 0.
+//
+static void P_AllocBlockMap (int size)
+{
+    int		numblocks;
+
+    numblocks = bmapwidth*bmapheight;
+    blockmap = Z_Malloc (numblocks*sizeof(*blockmap), PU_LEVEL, 0);
+    memset (blockmap, 0, numblocks*sizeof(*blockmap));
+    blockempty = Z_Malloc ((numblocks+7)/8, PU_LEVEL, 0);
+    memset (blockempty, 0xff, (numblocks+7)/8);
+
+    blocklistsize = size+1;
+    blocklists = Z_Malloc (blocklistsize*sizeof(*blocklists), PU_LEVEL, 0);
+    blocklists[0] = -1;
+    emptyblocks = numblocks;
+}
+
+
+//
+// P_ReadBlockList
+// Returns the number of lines in the list of the block that are
+// not in it already or line 0 with blockzero, copying them to out
+// unless it is NULL.
+//
+static int
+P_ReadBlockList
+( short*	list,
+  int		block,
+  int*		seen,
+  int*		out )
+{
+    int		count;
+    int		line;
+
+    if (blockzero)
+    {
+	seen[0] = block;
+	list++;
+    }
+
+    count = 0;
+    for ( ; (line = (unsigned short)SHORT(*list)) != 0xffff ; list++)
+    {
+	if (seen[line] == block)
+	    continue;
+	seen[line] = block;
+	if (out)
+	    out[count] = line;
+	count++;
+    }
+    return count;
+}
+
+
+//
+// P_ReadBlockMap
+// Returns false if the lump can't be used.
+//
+static boolean P_ReadBlockMap (int lump)
+{
+    short*	data;
+    int*	seen;
+    int		count;
+    int		numblocks;
+    int		offset;
+    int		size;
+    int		pos;
+    int		len;
+    int		i;
+
+    count = W_LumpLength (lump)/2;
+
+    // unsigned offsets can't reach past 64k shorts
+    if (count < 4 || count > 0x10000)
+	return false;
+
+    data = W_CacheLumpNum (lump, PU_STATIC);
+    bmaporgx = SHORT(data[0])<<FRACBITS;
+    bmaporgy = SHORT(data[1])<<FRACBITS;
+    bmapwidth = SHORT(data[2]);
+    bmapheight = SHORT(data[3]);
+    numblocks = bmapwidth*bmapheight;
+
+    if (bmapwidth <= 0 || bmapheight <= 0 || 4+numblocks > count)
+    {
+	Z_Free (data);
+	return false;
+    }
+
+    // every list must end in the lump and name real lines
+    blockzero = true;
+    for (i=0 ; i<numblocks ; i++)
+    {
+	offset = (unsigned short)SHORT(data[4+i]);
+	if (offset >= count)
+	{
+	    Z_Free (data);
+	    return false;
+	}
+	if (SHORT(data[offset]) != 0)
+	    blockzero = false;
+
+	len = 0;
+	for ( ; offset < count ; offset++)
+	{
+	    len = (unsigned short)SHORT(data[offset]);
+	    if (len == 0xffff || len >= numlines)
+		break;
+	}
+	if (offset == count || len != 0xffff)
+	{
+	    Z_Free (data);
+	    return false;
+	}
+    }
+
+    seen = Z_Malloc (numlines*sizeof(*seen), PU_STATIC, 0);
+    memset (seen, 0xff, numlines*sizeof(*seen));
+
+    size = 0;
+    for (i=0 ; i<numblocks ; i++)
+    {
+	len = P_ReadBlockList (data+(unsigned short)SHORT(data[4+i]),
+			       i, seen, NULL);
+	if (len)
+	    size += len+1;
+    }
+
+    P_AllocBlockMap (size);
+
+    memset (seen, 0xff, numlines*sizeof(*seen));
+    pos = 1;
+    for (i=0 ; i<numblocks ; i++)
+    {
+	len = P_ReadBlockList (data+(unsigned short)SHORT(data[4+i]),
+			       i, seen, blocklists+pos);
+	if (!len)
+	    continue;
+
+	blockmap[i] = pos;
+	blockempty[i>>3] &= ~(1<<(i&7));
+	emptyblocks--;
+	pos += len;
+	blocklists[pos++] = -1;
+    }
+
+    Z_Free (seen);
+    Z_Free (data);
+    return true;
+}
+
+
+//
+// P_LineBlocks
+// Counts the line in every block it touches, or with fill,
+// adds it to their lists.
+//
+static void
+P_LineBlocks
+( int		linenum,
+  int*		counts,
+  int*		fill )
+{
+    line_t*	ld;
+    int		x1;
+    int		y1;
+    int		dx;
+    int		dy;
+    int		bxl;
+    int		bxh;
+    int		byl;
+    int		byh;
+    int		bx;
+    int		by;
+    int		left;
+    int		bottom;
+    int		sides;
+    int		block;
+    int64_t	side;
+
+    ld = &lines[linenum];
+
+    // in map units from the blockmap origin
+    x1 = (ld->v1->x - bmaporgx)>>FRACBITS;
+    y1 = (ld->v1->y - bmaporgy)>>FRACBITS;
+    dx = ld->dx>>FRACBITS;
+    dy = ld->dy>>FRACBITS;
+
+    bxl = (dx < 0 ? x1+dx : x1)>>MAPBTOFRAC;
+    bxh = (dx < 0 ? x1 : x1+dx)>>MAPBTOFRAC;
+    byl = (dy < 0 ? y1+dy : y1)>>MAPBTOFRAC;
+    byh = (dy < 0 ? y1 : y1+dy)>>MAPBTOFRAC;
+
+    for (by=byl ; by<=byh ; by++)
+    {
+	for (bx=bxl ; bx<=bxh ; bx++)
+	{
+	    // a diagonal line may miss some blocks of its box;
+	    // it touches a block unless all corners are on one side
+	    if (bxl != bxh && byl != byh)
+	    {
+		left = (bx<<MAPBTOFRAC) - x1;
+		bottom = (by<<MAPBTOFRAC) - y1;
+		sides = 0;
+		side = (int64_t)dx*bottom - (int64_t)dy*left;
+		sides |= side > 0 ? 1 : side < 0 ? 2 : 3;
+		side += (int64_t)dx*MAPBLOCKUNITS;
+		sides |= side > 0 ? 1 : side < 0 ? 2 : 3;
+		side -= (int64_t)dy*MAPBLOCKUNITS;
+		sides |= side > 0 ? 1 : side < 0 ? 2 : 3;
+		side -= (int64_t)dx*MAPBLOCKUNITS;
+		sides |= side > 0 ? 1 : side < 0 ? 2 : 3;
+		if (sides != 3)
+		    continue;
+	    }
+
+	    block = by*bmapwidth+bx;
+	    if (fill)
+		blocklists[fill[block]++] = linenum;
+	    else
+		counts[block]++;
+	}
+    }
+}
+
+
+//
+// P_CreateBlockMap
+// Builds the blockmap from the linedefs; the lines are added in
+// order, so every list is sorted and has no duplicates.
+//
+static void P_CreateBlockMap (void)
+{
+    int*	counts;
+    int		minx;
+    int		miny;
+    int		maxx;
+    int		maxy;
+    int		x;
+    int		y;
+    int		numblocks;
+    int		size;
+    int		pos;
+    int		i;
+
+    minx = miny = MAXINT;
+    maxx = maxy = MININT;
+    for (i=0 ; i<numvertexes ; i++)
+    {
+	x = vertexes[i].x>>FRACBITS;
+	y = vertexes[i].y>>FRACBITS;
+	if (x < minx)
+	    minx = x;
+	if (x > maxx)
+	    maxx = x;
+	if (y < miny)
+	    miny = y;
+	if (y > maxy)
+	    maxy = y;
+    }
+
+    bmaporgx = minx<<FRACBITS;
+    bmaporgy = miny<<FRACBITS;
+    bmapwidth = ((maxx-minx)>>MAPBTOFRAC) + 1;
+    bmapheight = ((maxy-miny)>>MAPBTOFRAC) + 1;
+    numblocks = bmapwidth*bmapheight;
+
+    // like the node builders' lists, with line 0 in all of them
+    blockzero = true;
+
+    counts = Z_Malloc (numblocks*sizeof(*counts), PU_STATIC, 0);
+    memset (counts, 0, numblocks*sizeof(*counts));
+    for (i=1 ; i<numlines ; i++)
+	P_LineBlocks (i, counts, NULL);
+
+    size = 0;
+    for (i=0 ; i<numblocks ; i++)
+	if (counts[i])
+	    size += counts[i]+1;
+
+    P_AllocBlockMap (size);
+
+    // counts becomes the fill position of each list
+    pos = 1;
+    for (i=0 ; i<numblocks ; i++)
+    {
+	if (!counts[i])
+	    continue;
+
+	blockmap[i] = pos;
+	blockempty[i>>3] &= ~(1<<(i&7));
+	emptyblocks--;
+	pos += counts[i];
+	blocklists[pos++] = -1;
+	counts[i] = blockmap[i];
+    }
+
+    for (i=1 ; i<numlines ; i++)
+	P_LineBlocks (i, NULL, counts);
+
+    Z_Free (counts);
+}
+
+
+//
+// P_BenchBlockMap
+//
+static void P_BenchBlockMap (int lump)
+{
+    uint64_t	start;
+    uint64_t	lumpns;
+    uint64_t	createns;
+    boolean	ok;
+
+    start = sel4doom_get_current_time_ns ();
+    ok = P_ReadBlockMap (lump);
+    lumpns = sel4doom_get_current_time_ns () - start;
+    if (ok)
+    {
+	printf ("P_LoadBlockMap: %.8s: lump %ix%i blocks, %i empty, "
+		"%i shorts -> %i ints, %.3f ms\n",
+		lumpinfo[lump-ML_BLOCKMAP].name, bmapwidth, bmapheight,
+		emptyblocks, W_LumpLength (lump)/2,
+		bmapwidth*bmapheight + blocklistsize, lumpns / 1e6);
+	P_FreeBlockMap ();
+    }
+    else
+	printf ("P_LoadBlockMap: %.8s: lump unusable\n",
+		lumpinfo[lump-ML_BLOCKMAP].name);
+
+    start = sel4doom_get_current_time_ns ();
+    P_CreateBlockMap ();
+    createns = sel4doom_get_current_time_ns () - start;
+    printf ("P_LoadBlockMap: %.8s: rebuilt %ix%i blocks, %i empty, "
+	    "%i lines, %i ints, %.3f ms\n",
+	    lumpinfo[lump-ML_BLOCKMAP].name, bmapwidth, bmapheight,
+	    emptyblocks, numlines,
+	    bmapwidth*bmapheight + blocklistsize, createns / 1e6);
+    P_FreeBlockMap ();
+}
+
+
 //
 // P_LoadBlockMap
+// Needs the vertexes and linedefs.
 //
 void P_LoadBlockMap (int lump)
 {
-    int		i;
     int		count;
-	
-    blockmaplump = W_CacheLumpNum (lump,PU_LEVEL);
-    blockmap = blockmaplump+4;
-    count = W_LumpLength (lump)/2;
 
-    for (i=0 ; i<count ; i++)
-	blockmaplump[i] = SHORT(blockmaplump[i]);
-		
-    bmaporgx = blockmaplump[0]<<FRACBITS;
-    bmaporgy = blockmaplump[1]<<FRACBITS;
-    bmapwidth = blockmaplump[2];
-    bmapheight = blockmaplump[3];
+    if (M_CheckParm ("-blockmapbench"))
+	P_BenchBlockMap (lump);
+
+    if (M_CheckParm ("-blockmap") || !P_ReadBlockMap (lump))
+	P_CreateBlockMap ();
 	
     // clear out mobj chains
     count = sizeof(*blocklinks)* bmapwidth*bmapheight;
     blocklinks = Z_Malloc (count,PU_LEVEL, 0);
     memset (blocklinks, 0, count);
+
+    finewidth = bmapwidth*FINETHINGS;
+    count = sizeof(*finelinks)*finewidth*bmapheight*FINETHINGS;
+    finelinks = Z_Malloc (count,PU_LEVEL, 0);
+    memset (finelinks, 0, count);
+
+    count = sizeof(*bigthings)*bmapwidth*bmapheight;
+    bigthings = Z_Malloc (count,PU_LEVEL, 0);
+    memset (bigthings, 0, count);
 }
 
 
@@ -617,6 +1007,8 @@ P_SetupLevel
 #endif
 	Z_FreeTags (PU_LEVEL, PU_PURGELEVEL-1);
 
+    P_ClearThinkerPools ();
+    memset (mobjlive, 0, sizeof(mobjlive));
 
     // UNUSED W_Profile ();
     P_InitThinkers ();
@@ -646,12 +1038,12 @@ P_SetupLevel
     leveltime = 0;
 	
     // note: most of this ordering is important	
-    P_LoadBlockMap (lumpnum+ML_BLOCKMAP);
     P_LoadVertexes (lumpnum+ML_VERTEXES);
     P_LoadSectors (lumpnum+ML_SECTORS);
     P_LoadSideDefs (lumpnum+ML_SIDEDEFS);
 
     P_LoadLineDefs (lumpnum+ML_LINEDEFS);
+    P_LoadBlockMap (lumpnum+ML_BLOCKMAP);
     P_LoadSubsectors (lumpnum+ML_SSECTORS);
     P_LoadNodes (lumpnum+ML_NODES);
     P_LoadSegs (lumpnum+ML_SEGS);
@@ -690,6 +1082,8 @@ P_SetupLevel
 
     //printf ("free memory: 0x%x\n", Z_FreeMemory());
 
+    if (M_CheckParm ("-thingbench"))
+	P_ThingGridBench ();
 }
 
 
@@ -702,6 +1096,8 @@ void P_Init (void)
     P_InitSwitchList ();
     P_InitPicAnims ();
     R_InitSprites (sprnames);
+
+    finethings = M_CheckParm ("-finethings") || M_CheckParm ("-thingbench");
 }
 
 
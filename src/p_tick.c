@@ -25,7 +25,11 @@
 static const char
 rcsid[] = "$Id: p_tick.c,v 1.4 1997/02/03 16:47:55 b1 Exp $";
 
+#include <stdio.h>
+
 #include "z_zone.h"
+#include "i_system.h"
+#include "m_argv.h"
 #include "p_local.h"
 
 #include "doomstat.h"
@@ -35,7 +39,7 @@ int	leveltime;
 
 //
 // THINKERS
-// All thinkers should be allocated by Z_Malloc
+// All thinkers should be allocated by P_AllocThinker
 // so they can be operated on uniformly.
 // The actual structures will vary in size,
 // but the first element must be thinker_t.
@@ -47,6 +51,63 @@ int	leveltime;
 thinker_t	thinkercap;
 
 
+//
+// Thinker pools: the thinkers of a class (mobjs, lights, movers)
+//  are carved out of slabs, so they lie next to each other instead
+//  of all over the zone. The slabs are level memory and all go at
+//  once with the level; a projectile or puff never goes through the
+//  zone.
+// Freed entries are reused oldest first, and only once more than a
+//  slab's worth of them wait: other mobjs still point at removed
+//  ones (target, tracer, lastenemy), and like a freed zone block
+//  behind the rover, a removed mobj has to keep its last state for
+//  a while, or demos go out of sync.
+// Every entry has a head in front of the thinker (thinkerhead_t)
+//  that tells P_FreeThinker where it came from.
+// The pools are used with -thinkerpools only: reuse timing can show
+//  in demos, and sync has not been checked against the original yet.
+//  Otherwise every thinker is a zone block of its own, as there.
+//
+#define THINKERSLAB	64	// entries per slab
+#define MOBJSLAB	256
+
+typedef struct tpool_s
+{
+    char*		name;
+    int			size;		// of an entry, with its head
+    int			slabentries;
+    int			tag;		// of the zone blocks
+    thinkerhead_t*	freelist;	// oldest first
+    thinkerhead_t*	freetail;
+    int			numfree;
+    byte*		slab;		// being carved up
+    int			slableft;	// entries left in it
+
+    // for -mobjstats; numslabs and inuse are per level
+    int			numslabs;
+    int			inuse;
+    int			maxslabs;
+    int			peak;
+} tpool_t;
+
+#define MAX2(a,b)	((a) > (b) ? (a) : (b))
+#define POOLSIZE(s) \
+	((sizeof(thinkerhead_t) + (s) + sizeof(void*)-1) & ~(sizeof(void*)-1))
+
+static tpool_t	pools[NUMTHINKERPOOLS] =
+{
+    {"mobjs", POOLSIZE(sizeof(mobj_t)), MOBJSLAB, PU_LEVEL},
+    {"lights", POOLSIZE(MAX2 (MAX2 (sizeof(fireflicker_t), sizeof(lightflash_t)),
+			      MAX2 (sizeof(strobe_t), sizeof(glow_t)))),
+     THINKERSLAB, PU_LEVSPEC},
+    {"movers", POOLSIZE(MAX2 (MAX2 (sizeof(plat_t), sizeof(vldoor_t)),
+			      MAX2 (sizeof(ceiling_t), sizeof(floormove_t)))),
+     THINKERSLAB, PU_LEVSPEC}
+};
+
+static boolean	thinkerpools;
+
+
 //
 // P_InitThinkers
 //
@@ -56,6 +117,151 @@ void P_InitThinkers (void)
 }
 
 
+//
+// P_ClearThinkerPools
+// At level setup, after Z_FreeTags took the slabs.
+//
+void P_ClearThinkerPools (void)
+{
+    int		i;
+    
+    thinkerpools = M_CheckParm ("-thinkerpools") != 0;
+    for (i=0 ; i<NUMTHINKERPOOLS ; i++)
+    {
+	pools[i].freelist = pools[i].freetail = NULL;
+	pools[i].numfree = 0;
+	pools[i].slab = NULL;
+	pools[i].slableft = 0;
+	pools[i].numslabs = 0;
+	pools[i].inuse = 0;
+    }
+}
+
+
+//
+// P_AllocThinker
+// Returns "size" bytes for a thinker of the given pool;
+//  the caller fills it in and adds it with P_AddThinker.
+//
+void* P_AllocThinker (thinkerpool_t pool, int size)
+{
+    tpool_t*		p;
+    thinkerhead_t*	head;
+
+    p = &pools[pool];
+    if (sizeof(*head) + size > p->size)
+	I_Error ("P_AllocThinker: %i bytes are too many for pool %i",
+		 size, pool);
+
+    if (!thinkerpools)
+    {
+	head = Z_Malloc (sizeof(*head) + size, p->tag, NULL);
+	head->u.pool = NULL;
+	return head+1;
+    }
+
+    if (++p->inuse > p->peak)
+	p->peak = p->inuse;
+
+    if (p->numfree > p->slabentries)
+    {
+	head = p->freelist;
+	p->freelist = head->u.nextfree;
+	p->numfree--;
+    }
+    else
+    {
+	if (!p->slableft)
+	{
+	    p->slab = Z_Malloc (p->slabentries*p->size, p->tag, NULL);
+	    p->slableft = p->slabentries;
+	    if (++p->numslabs > p->maxslabs)
+		p->maxslabs = p->numslabs;
+	}
+	head = (thinkerhead_t *)p->slab;
+	p->slab += p->size;
+	p->slableft--;
+    }
+
+    head->u.pool = p;
+    return head+1;
+}
+
+
+//
+// P_FreeThinker
+// Gives the memory of a thinker that is no longer in the list
+//  back to its pool. The thinker itself is left as it is.
+//
+void P_FreeThinker (thinker_t* thinker)
+{
+    thinkerhead_t*	head;
+    tpool_t*		p;
+
+    head = (thinkerhead_t *)thinker - 1;
+    p = head->u.pool;
+    if (!p)
+    {
+	Z_Free (head);
+	return;
+    }
+
+    head->u.nextfree = NULL;
+    if (p->freelist)
+	p->freetail->u.nextfree = head;
+    else
+	p->freelist = head;
+    p->freetail = head;
+    p->numfree++;
+    p->inuse--;
+}
+
+
+//
+// P_DropThinker
+// Like P_FreeThinker, but an entry of a pool stays unused until
+//  the level ends; for the thinkers a loaded game replaces.
+//
+void P_DropThinker (thinker_t* thinker)
+{
+    thinkerhead_t*	head;
+
+    head = (thinkerhead_t *)thinker - 1;
+    if (!head->u.pool)
+    {
+	Z_Free (head);
+	return;
+    }
+    head->u.pool->inuse--;
+}
+
+
+//
+// P_PrintStats
+// Mobjs spawned per type and the high water marks of the
+//  thinker pools, printed on quit with -mobjstats.
+//
+void P_PrintStats (void)
+{
+    int		i;
+
+    printf ("P_PrintStats: type sprite  spawned max/level\n");
+    for (i=0 ; i<NUMMOBJTYPES ; i++)
+    {
+	if (!mobjspawned[i])
+	    continue;
+	printf ("P_PrintStats: %4i %-6s %8i %9i\n",
+		i, sprnames[states[mobjinfo[i].spawnstate].sprite],
+		mobjspawned[i], mobjpeak[i]);
+    }
+
+    for (i=0 ; i<NUMTHINKERPOOLS ; i++)
+	printf ("P_PrintStats: %s: max %i per level in %i slabs of %i\n",
+		pools[i].name, pools[i].peak, pools[i].maxslabs,
+		pools[i].slabentries);
+}
+
+
 
 
 //
@@ -110,7 +316,7 @@ void P_RunThinkers (void)
 	    // time to remove it
 	    currentthinker->next->prev = currentthinker->prev;
 	    currentthinker->prev->next = currentthinker->next;
-	    Z_Free (currentthinker);
+	    P_FreeThinker (currentthinker);
 	}
 	else
 	{
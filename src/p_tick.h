@@ -34,6 +34,9 @@
 // Carries out all thinking of monsters and players.
 void P_Ticker (void);
 
+// Called by I_Quit.
+void P_PrintStats (void);
+
 
 
 #endif
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2015, Josef Mihalits
+ *
+ * This software may be distributed and modified according to the terms of
+ * the GNU General Public License version 2. Note that NO WARRANTY is provided.
+ * See "COPYING" for details.
+ *
+ */
+
+/*
+ * Frame arena.
+ *
+ * Every render thread allocates its per frame data front to back from a
+ * list of zone blocks; R_ClearFrameArena just rewinds. When a frame did
+ * not fit into the first block, another one was chained on, and on the
+ * next R_ClearFrameArena all blocks are replaced by a single one as big
+ * as all of them together. So the arena settles at one block the size of
+ * the busiest frame so far, and frames no longer go to the zone at all.
+ *
+ * "-framearena kb" sets the initial size of the arena of each thread;
+ * -renderstats prints the most ever used per frame, to size it with.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "z_zone.h"
+#include "m_argv.h"
+
+#include "r_local.h"
+#include "r_arena.h"
+
+
+#define FRAMEARENA	(128*1024)	// default initial size, bytes
+#define FRAMEALIGN	8
+
+typedef struct arenablock_s
+{
+    struct arenablock_s*	next;
+    byte*			data;	// FRAMEALIGN aligned
+    int				size;	// of data
+    int				used;
+} arenablock_t;
+
+static const char* tagnames[NUMFRAMEALLOCS] =
+{
+    "visplanes", "drawsegs", "dsbins", "openings", "vissprites"
+};
+
+static int			initsize = FRAMEARENA;
+
+static RENDERLOCAL arenablock_t*	firstblock;
+static RENDERLOCAL arenablock_t*	curblock;
+static RENDERLOCAL int		arenasize;	// all blocks
+
+// bytes used by the current frame, per tag
+static RENDERLOCAL int		frameused[NUMFRAMEALLOCS];
+
+// most ever used per frame by a thread, see R_FrameArenaStats
+static int			framepeak[NUMFRAMEALLOCS];
+static int			totalpeak;
+static int			maxarena;	// biggest arena of a thread
+
+
+static arenablock_t* R_NewArenaBlock (int size)
+{
+    arenablock_t*	b;
+
+    R_LockZone ();
+    b = Z_Malloc (sizeof(*b) + size + FRAMEALIGN, PU_STATIC, NULL);
+    R_UnlockZone ();
+
+    b->next = NULL;
+    b->data = (byte *)(((intptr_t)(b+1) + FRAMEALIGN-1) & ~(FRAMEALIGN-1));
+    b->size = size;
+    b->used = 0;
+    arenasize += size;
+    return b;
+}
+
+
+void R_InitFrameArena (void)
+{
+    int		p;
+
+    p = M_CheckParm ("-framearena");
+    if (p && p < myargc-1)
+	initsize = atoi (myargv[p+1]) * 1024;
+    if (initsize < 1024)
+	initsize = 1024;
+}
+
+
+void R_ClearFrameArena (void)
+{
+    arenablock_t*	b;
+    arenablock_t*	next;
+    int			size;
+
+    memset (frameused, 0, sizeof(frameused));
+
+    if (firstblock && !firstblock->next)
+    {
+	firstblock->used = 0;
+	curblock = firstblock;
+	return;
+    }
+
+    // first frame, or the last one overflowed: one block for all
+    size = initsize;
+    if (firstblock)
+    {
+	size = 0;
+	arenasize = 0;
+	R_LockZone ();
+	for (b=firstblock ; b ; b=next)
+	{
+	    next = b->next;
+	    size += b->size;
+	    Z_Free (b);
+	}
+	R_UnlockZone ();
+    }
+
+    firstblock = curblock = R_NewArenaBlock (size);
+}
+
+
+void* R_FrameAlloc (int size, frametag_t tag)
+{
+    void*	p;
+
+    size = (size + FRAMEALIGN-1) & ~(FRAMEALIGN-1);
+
+    if (curblock->used + size > curblock->size)
+    {
+	curblock->next = R_NewArenaBlock (size > curblock->size ?
+					  size : curblock->size);
+	curblock = curblock->next;
+    }
+
+    p = curblock->data + curblock->used;
+    curblock->used += size;
+    frameused[tag] += size;
+    return p;
+}
+
+
+void* R_FrameRealloc (void* old, int oldsize, int newsize, frametag_t tag)
+{
+    byte*	p;
+    int		start;
+
+    oldsize = (oldsize + FRAMEALIGN-1) & ~(FRAMEALIGN-1);
+    newsize = (newsize + FRAMEALIGN-1) & ~(FRAMEALIGN-1);
+
+    // the last allocation grows in place if there is room
+    p = old;
+    start = p - curblock->data;
+    if (p && start >= 0 && start + oldsize == curblock->used
+	&& start + newsize <= curblock->size)
+    {
+	curblock->used = start + newsize;
+	frameused[tag] += newsize - oldsize;
+	return old;
+    }
+
+    p = R_FrameAlloc (newsize, tag);
+    if (old)
+	memcpy (p, old, oldsize < newsize ? oldsize : newsize);
+    return p;
+}
+
+
+void R_FrameArenaStats (void)
+{
+    int		total;
+    int		i;
+
+    total = 0;
+    for (i=0 ; i<NUMFRAMEALLOCS ; i++)
+    {
+	if (frameused[i] > framepeak[i])
+	    framepeak[i] = frameused[i];
+	total += frameused[i];
+    }
+    if (total > totalpeak)
+	totalpeak = total;
+    if (arenasize > maxarena)
+	maxarena = arenasize;
+}
+
+
+void R_PrintFrameArenaStats (void)
+{
+    int		i;
+
+    printf ("R_PrintStats: frame arena: max %i bytes per frame, "
+	    "%i bytes per thread\n", totalpeak, maxarena);
+    for (i=0 ; i<NUMFRAMEALLOCS ; i++)
+	printf ("R_PrintStats:   %-10s max %i bytes per frame\n",
+		tagnames[i], framepeak[i]);
+}
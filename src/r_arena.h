@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2015, Josef Mihalits
+ *
+ * This software may be distributed and modified according to the terms of
+ * the GNU General Public License version 2. Note that NO WARRANTY is provided.
+ * See "COPYING" for details.
+ *
+ */
+
+#ifndef __R_ARENA__
+#define __R_ARENA__
+
+#include "doomtype.h"
+
+//
+// Frame arena: the per frame working storage of the refresh
+//  (visplanes, drawsegs, openings, vissprites, ...) comes from a
+//  bump allocator that every render thread resets at frame start.
+//
+typedef enum
+{
+    fa_visplanes,
+    fa_drawsegs,
+    fa_dsbins,
+    fa_openings,
+    fa_vissprites,
+    NUMFRAMEALLOCS
+} frametag_t;
+
+void R_InitFrameArena (void);
+
+// Frees everything allocated since the last call; called by every
+//  render thread at the start of a frame, before any R_Clear*.
+void R_ClearFrameArena (void);
+
+// Valid until the next R_ClearFrameArena, 8 byte aligned.
+void* R_FrameAlloc (int size, frametag_t tag);
+
+// Returns a copy of the first "oldsize" bytes of "old" in "newsize"
+//  bytes; "old" stays valid, too, until the end of the frame.
+void* R_FrameRealloc (void* old, int oldsize, int newsize, frametag_t tag);
+
+// Adds the use of the current frame to the most ever used; the
+//  caller holds the zone lock.
+void R_FrameArenaStats (void);
+
+// Prints the most ever used per frame; see R_PrintStats.
+void R_PrintFrameArenaStats (void);
+
+#endif
@@ -26,15 +26,20 @@ static const char
 rcsid[] = "$Id: r_bsp.c,v 1.4 1997/02/03 22:45:12 b1 Exp $";
 
 
+#include <string.h>
+
 #include "doomdef.h"
 
 #include "m_bbox.h"
 
 #include "i_system.h"
+#include "z_zone.h"
 
 #include "r_main.h"
+#include "r_bsp.h"
 #include "r_plane.h"
 #include "r_things.h"
+#include "r_arena.h"
 
 // State.
 #include "doomstat.h"
@@ -44,14 +49,20 @@ rcsid[] = "$Id: r_bsp.c,v 1.4 1997/02/03 22:45:12 b1 Exp $";
 
 
 
-seg_t*		curline;
-side_t*		sidedef;
-line_t*		linedef;
-sector_t*	frontsector;
-sector_t*	backsector;
+RENDERLOCAL seg_t*		curline;
+RENDERLOCAL side_t*		sidedef;
+RENDERLOCAL line_t*		linedef;
+RENDERLOCAL sector_t*	frontsector;
+RENDERLOCAL sector_t*	backsector;
+
+// The drawsegs of a frame, in the frame arena. allocdrawsegs is
+//  kept from frame to frame, so it only doubles a few times.
+RENDERLOCAL drawseg_t*	drawsegs;
+RENDERLOCAL drawseg_t*	ds_p;
+int		maxdrawsegs;
+RENDERLOCAL int		allocdrawsegs;
 
-drawseg_t	drawsegs[MAXDRAWSEGS];
-drawseg_t*	ds_p;
+RENDERLOCAL dsbin_t		dsbins[MAXDSBINS];
 
 
 void
@@ -67,7 +78,72 @@ R_StoreWallRange
 //
 void R_ClearDrawSegs (void)
 {
+    int		i;
+
+    if (!allocdrawsegs)
+	allocdrawsegs = MAXDRAWSEGS;
+    drawsegs = R_FrameAlloc (allocdrawsegs*sizeof(*drawsegs), fa_drawsegs);
     ds_p = drawsegs;
+
+    for (i=0 ; i<NUMDSBINS ; i++)
+    {
+	dsbins[i].segs = NULL;
+	dsbins[i].numsegs = 0;
+    }
+}
+
+
+//
+// R_GrowDrawSegs
+// Doubles the size of drawsegs[] when it is full.
+//
+void R_GrowDrawSegs (void)
+{
+    drawseg_t*	newsegs;
+    int		newalloc;
+
+    newalloc = allocdrawsegs*2;
+    newsegs = R_FrameRealloc (drawsegs, allocdrawsegs*sizeof(*newsegs),
+			      newalloc*sizeof(*newsegs), fa_drawsegs);
+
+    ds_p = newsegs + (ds_p - drawsegs);
+    drawsegs = newsegs;
+    allocdrawsegs = newalloc;
+}
+
+
+//
+// R_IndexDrawSeg
+// Adds a finished drawseg to the bins it covers if it can clip sprites.
+//
+void R_IndexDrawSeg (drawseg_t* ds)
+{
+    dsbin_t*	bin;
+    int		b;
+
+    if (!ds->silhouette && !ds->maskedtexturecol)
+	return;
+
+    for (b = ds->x1>>DSBINSHIFT ; b <= ds->x2>>DSBINSHIFT ; b++)
+    {
+	bin = &dsbins[b];
+	if (!bin->segs)
+	{
+	    if (!bin->allocsegs)
+		bin->allocsegs = 64;
+	    bin->segs = R_FrameAlloc (bin->allocsegs*sizeof(*bin->segs),
+				      fa_dsbins);
+	}
+	else if (bin->numsegs == bin->allocsegs)
+	{
+	    bin->segs = R_FrameRealloc (bin->segs,
+					bin->allocsegs*sizeof(*bin->segs),
+					bin->allocsegs*2*sizeof(*bin->segs),
+					fa_dsbins);
+	    bin->allocsegs *= 2;
+	}
+	bin->segs[bin->numsegs++] = ds - drawsegs;
+    }
 }
 
 
@@ -85,11 +161,12 @@ typedef	struct
 } cliprange_t;
 
 
-#define MAXSEGS		32
+// enough for every other column being solid
+#define MAXSEGS		(MAXSCREENWIDTH/2+1)
 
 // newend is one past the last valid seg
-cliprange_t*	newend;
-cliprange_t	solidsegs[MAXSEGS];
+RENDERLOCAL cliprange_t*	newend;
+RENDERLOCAL cliprange_t	solidsegs[MAXSEGS];
 
 
 
@@ -245,8 +322,8 @@ R_ClipPassWallSegment
 void R_ClearClipSegs (void)
 {
     solidsegs[0].first = -0x7fffffff;
-    solidsegs[0].last = -1;
-    solidsegs[1].first = viewwidth;
+    solidsegs[0].last = stripx1-1;
+    solidsegs[1].first = stripx2+1;
     solidsegs[1].last = 0x7fffffff;
     newend = solidsegs+2;
 }
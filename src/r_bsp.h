@@ -28,25 +28,46 @@
 #endif
 
 
-extern seg_t*		curline;
-extern side_t*		sidedef;
-extern line_t*		linedef;
-extern sector_t*	frontsector;
-extern sector_t*	backsector;
+extern RENDERLOCAL seg_t*		curline;
+extern RENDERLOCAL side_t*		sidedef;
+extern RENDERLOCAL line_t*		linedef;
+extern RENDERLOCAL sector_t*	frontsector;
+extern RENDERLOCAL sector_t*	backsector;
 
-extern int		rw_x;
-extern int		rw_stopx;
+extern RENDERLOCAL int		rw_x;
+extern RENDERLOCAL int		rw_stopx;
 
-extern boolean		segtextured;
+extern RENDERLOCAL boolean		segtextured;
 
 // false if the back side is the same plane
-extern boolean		markfloor;		
-extern boolean		markceiling;
+extern RENDERLOCAL boolean		markfloor;		
+extern RENDERLOCAL boolean		markceiling;
 
 extern boolean		skymap;
 
-extern drawseg_t	drawsegs[MAXDRAWSEGS];
-extern drawseg_t*	ds_p;
+extern RENDERLOCAL drawseg_t*	drawsegs;
+extern RENDERLOCAL drawseg_t*	ds_p;
+extern int		maxdrawsegs;	// high water mark per frame
+extern RENDERLOCAL int		allocdrawsegs;	// size of drawsegs[]
+
+//
+// Drawsegs that can clip sprites (those with a silhouette or a
+//  masked mid texture) are indexed by screen x: bin b lists, in
+//  increasing order, the drawsegs[] indices of the segs that cover
+//  any of the columns b<<DSBINSHIFT ... ((b+1)<<DSBINSHIFT)-1.
+//
+#define DSBINSHIFT		4
+#define NUMDSBINS		((SCREENWIDTH + (1<<DSBINSHIFT) - 1) >> DSBINSHIFT)
+#define MAXDSBINS		((MAXSCREENWIDTH + (1<<DSBINSHIFT) - 1) >> DSBINSHIFT)
+
+typedef struct
+{
+    int*		segs;
+    int			numsegs;
+    int			allocsegs;
+} dsbin_t;
+
+extern RENDERLOCAL dsbin_t		dsbins[MAXDSBINS];
 
 extern lighttable_t**	hscalelight;
 extern lighttable_t**	vscalelight;
@@ -60,6 +81,10 @@ typedef void (*drawfunc_t) (int start, int stop);
 void R_ClearClipSegs (void);
 void R_ClearDrawSegs (void);
 
+// Called by R_StoreWallRange.
+void R_GrowDrawSegs (void);
+void R_IndexDrawSeg (drawseg_t* ds);
+
 
 void R_RenderBSPNode (int bspnum);
 
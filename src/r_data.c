@@ -687,7 +687,7 @@ int R_FlatNumForName (char* name)
     int		i;
     char	namet[9];
 
-    i = W_CheckNumForName (name);
+    i = W_CheckNumForNameNs (name, ns_flats);
 
     if (i == -1)
     {
@@ -743,6 +743,25 @@ int	R_TextureNumForName (char* name)
 }
 
 
+//
+// R_PrecacheComposites
+// Builds the composites of all textures and keeps them,
+//  so that R_GetColumn never has to (see R_InitRenderThreads).
+//
+void R_PrecacheComposites (void)
+{
+    int		i;
+
+    for (i=0 ; i<numtextures ; i++)
+    {
+	if (!texturecompositesize[i] || texturecomposite[i])
+	    continue;
+	R_GenerateComposite (i);
+	Z_ChangeTag (texturecomposite[i], PU_STATIC);
+    }
+}
+
+
 
 
 //
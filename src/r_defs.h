@@ -52,8 +52,20 @@
 #define SIL_TOP			2
 #define SIL_BOTH		3
 
+// initial size of drawsegs[], which grows on demand
 #define MAXDRAWSEGS		256
 
+// Strip-parallel rendering (see R_RenderPlayerView).
+// With RENDER_THREADS, every render thread has its own copy
+//  of the refresh working state, which is marked RENDERLOCAL.
+#ifdef RENDER_THREADS
+#define MAXRENDERTHREADS	8
+#define RENDERLOCAL		__thread
+#else
+#define MAXRENDERTHREADS	1
+#define RENDERLOCAL
+#endif
+
 
 
 
@@ -123,6 +135,9 @@ typedef	struct
     // if == validcount, already checked
     int		validcount;
 
+    // same for R_AddSprites, per render strip
+    int		spritevalid[MAXRENDERTHREADS];
+
     // list of mobjs in sector
     mobj_t*	thinglist;
 
@@ -457,28 +472,26 @@ typedef struct
 //
 // Now what is a visplane, anyway?
 // 
-typedef struct
+typedef struct visplane_s
 {
+  struct visplane_s*	next;		// hash chain / free list
+
   fixed_t		height;
   int			picnum;
   int			lightlevel;
   int			minx;
   int			maxx;
   
-  // leave pads for [minx-1]/[maxx+1]
-  
-  byte		pad1;
-  // Here lies the rub for all
-  //  dynamic resize/change of resolution.
-  byte		top[SCREENWIDTH];
-  byte		pad2;
-  byte		pad3;
-  // See above.
-  byte		bottom[SCREENWIDTH];
-  byte		pad4;
+  // [SCREENWIDTH] each, allocated with the visplane
+  //  (see R_NewPlane), with pads for [minx-1]/[maxx+1].
+  // VP_EMPTY in top, over 0 in bottom, marks an unused column.
+  unsigned short*	top;
+  unsigned short*	bottom;
 
 } visplane_t;
 
+#define VP_EMPTY		0xffff
+
 
 
 
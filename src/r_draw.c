@@ -28,6 +28,8 @@ static const char
 rcsid[] = "$Id: r_draw.c,v 1.4 1997/02/03 16:47:55 b1 Exp $";
 
 
+#include <stdint.h>
+
 #include "doomdef.h"
 
 #include "i_system.h"
@@ -43,12 +45,8 @@ rcsid[] = "$Id: r_draw.c,v 1.4 1997/02/03 16:47:55 b1 Exp $";
 #include "doomstat.h"
 
 
-// ?
-#define MAXWIDTH			1120
-#define MAXHEIGHT			832
-
 // status bar height at bottom of screen
-#define SBARHEIGHT		32
+#define SBARHEIGHT		(32<<hires)
 
 //
 // All drawing to the view buffer is accomplished in this file.
@@ -66,8 +64,17 @@ int		scaledviewwidth;
 int		viewheight;
 int		viewwindowx;
 int		viewwindowy; 
-byte*		ylookup[MAXHEIGHT]; 
-int		columnofs[MAXWIDTH]; 
+byte*		ylookup[MAXSCREENHEIGHT]; 
+int		columnofs[MAXSCREENWIDTH]; 
+
+// The view is drawn into screens[0], or with -colmajor into the
+//  column-major viewbuffer, where the drawers walking down a column
+//  write contiguous memory. rowpitch steps to the pixel below,
+//  colpitch to the one on the right; see R_InitBuffer.
+boolean		colmajor;
+byte*		viewbuffer;
+int		rowpitch;
+int		colpitch;
 
 // Color tables for different players,
 //  translate a limited part to another
@@ -82,18 +89,18 @@ byte		translations[3][256];
 // R_DrawColumn
 // Source is the top of the column to scale.
 //
-lighttable_t*		dc_colormap; 
-int			dc_x; 
-int			dc_yl; 
-int			dc_yh; 
-fixed_t			dc_iscale; 
-fixed_t			dc_texturemid;
+RENDERLOCAL lighttable_t*		dc_colormap; 
+RENDERLOCAL int			dc_x; 
+RENDERLOCAL int			dc_yl; 
+RENDERLOCAL int			dc_yh; 
+RENDERLOCAL fixed_t			dc_iscale; 
+RENDERLOCAL fixed_t			dc_texturemid;
 
 // first pixel in a column (possibly virtual) 
-byte*			dc_source;		
+RENDERLOCAL byte*			dc_source;		
 
 // just for profiling 
-int			dccount;
+RENDERLOCAL int			dccount;
 
 //
 // A column is a vertical slice/span from a wall texture that,
@@ -141,7 +148,7 @@ void R_DrawColumn (void)
 	//  using a lighting/special effects LUT.
 	*dest = dc_colormap[dc_source[(frac>>FRACBITS)&127]];
 	
-	dest += SCREENWIDTH; 
+	dest += rowpitch; 
 	frac += fracstep;
 	
     } while (count--); 
@@ -245,19 +252,177 @@ void R_DrawColumnLow (void)
     {
 	// Hack. Does not work corretly.
 	*dest2 = *dest = dc_colormap[dc_source[(frac>>FRACBITS)&127]];
-	dest += SCREENWIDTH;
-	dest2 += SCREENWIDTH;
+	dest += rowpitch;
+	dest2 += rowpitch;
 	frac += fracstep; 
 
     } while (count--);
 }
 
 
+//
+// Column batching.
+// R_QueueColumn and R_QueueTranslatedColumn draw into colbuf, where
+//  four neighbouring screen columns lie side by side in every row.
+//  R_FlushColumns copies the rows all four of them have to the screen
+//  with one 32 bit write per row instead of four byte writes a screen
+//  row apart; the ragged ends go byte by byte.
+// The group is flushed when a column of another group comes along, or
+//  one of its columns comes again (the posts of a masked column).
+//  Whatever reads or draws the screen directly has to flush first.
+// Only for full detail in screens[0], where columnofs[] is contiguous.
+//
+static RENDERLOCAL uint32_t	colbuf[MAXSCREENHEIGHT];
+static RENDERLOCAL int		colbufx;	// first column of the group
+static RENDERLOCAL int		colbufmask;	// columns in colbuf
+static RENDERLOCAL int		colbufyl[4];
+static RENDERLOCAL int		colbufyh[4];
+
+
+//
+// R_FlushColumnRows
+// Byte by byte copy of rows y1 to y2 of column i of the group.
+//
+static void
+R_FlushColumnRows
+( int		i,
+  int		y1,
+  int		y2 )
+{
+    byte*	src;
+    byte*	dest;
+
+    if (y1 > y2)
+	return;
+
+    src = (byte *)&colbuf[y1] + i;
+    dest = ylookup[y1] + columnofs[colbufx+i];
+
+    for ( ; y1<=y2 ; y1++)
+    {
+	*dest = *src;
+	src += 4;
+	dest += SCREENWIDTH;
+    }
+}
+
+
+void R_FlushColumns (void)
+{
+    int		i;
+    int		yl;
+    int		yh;
+    uint32_t*	dest;
+
+    if (!colbufmask)
+	return;
+
+    // the rows all four columns have
+    yl = 0;
+    yh = -1;
+    if (colbufmask == 15)
+    {
+	yl = colbufyl[0];
+	yh = colbufyh[0];
+	for (i=1 ; i<4 ; i++)
+	{
+	    if (colbufyl[i] > yl)
+		yl = colbufyl[i];
+	    if (colbufyh[i] < yh)
+		yh = colbufyh[i];
+	}
+    }
+
+    for (i=0 ; i<4 ; i++)
+    {
+	if (!(colbufmask & (1<<i)))
+	    continue;
+	if (yl > yh)
+	{
+	    R_FlushColumnRows (i, colbufyl[i], colbufyh[i]);
+	    continue;
+	}
+	R_FlushColumnRows (i, colbufyl[i], yl-1);
+	R_FlushColumnRows (i, yh+1, colbufyh[i]);
+    }
+
+    if (yl <= yh)
+    {
+	dest = (uint32_t *)(ylookup[yl] + columnofs[colbufx]);
+	for ( ; yl<=yh ; yl++)
+	{
+	    *dest = colbuf[yl];
+	    dest += SCREENWIDTH/4;
+	}
+    }
+
+    colbufmask = 0;
+}
+
+
+//
+// R_QueueColumnStart
+// Makes room for dc_x in the group, returns where row dc_yl goes.
+//
+static byte* R_QueueColumnStart (void)
+{
+    int		i;
+
+    i = dc_x & 3;
+    if (colbufmask
+	&& ((dc_x & ~3) != colbufx || (colbufmask & (1<<i))))
+	R_FlushColumns ();
+
+    colbufx = dc_x & ~3;
+    colbufmask |= 1<<i;
+    colbufyl[i] = dc_yl;
+    colbufyh[i] = dc_yh;
+
+    return (byte *)&colbuf[dc_yl] + i;
+}
+
+
+//
+// R_QueueColumn
+// R_DrawColumn into the batch.
+//
+void R_QueueColumn (void) 
+{ 
+    int			count; 
+    byte*		dest; 
+    fixed_t		frac;
+    fixed_t		fracstep;	 
+ 
+    count = dc_yh - dc_yl; 
+    if (count < 0) 
+	return; 
+				 
+#ifdef RANGECHECK 
+    if ((unsigned)dc_x >= SCREENWIDTH
+	|| dc_yl < 0
+	|| dc_yh >= SCREENHEIGHT) 
+	I_Error ("R_QueueColumn: %i to %i at %i", dc_yl, dc_yh, dc_x); 
+#endif 
+
+    dest = R_QueueColumnStart ();
+
+    fracstep = dc_iscale; 
+    frac = dc_texturemid + (dc_yl-centery)*fracstep; 
+
+    do 
+    {
+	*dest = dc_colormap[dc_source[(frac>>FRACBITS)&127]];
+	dest += 4; 
+	frac += fracstep;
+    } while (count--); 
+} 
+
+
 //
 // Spectre/Invisibility.
 //
 #define FUZZTABLE		50 
-#define FUZZOFF	(SCREENWIDTH)
+#define FUZZOFF	1		// in rows, times rowpitch
 
 
 int	fuzzoffset[FUZZTABLE] =
@@ -271,7 +436,7 @@ int	fuzzoffset[FUZZTABLE] =
     FUZZOFF,FUZZOFF,-FUZZOFF,FUZZOFF,FUZZOFF,-FUZZOFF,FUZZOFF 
 }; 
 
-int	fuzzpos = 0; 
+RENDERLOCAL int	fuzzpos = 0; 
 
 
 //
@@ -289,6 +454,9 @@ void R_DrawFuzzColumn (void)
     fixed_t		frac;
     fixed_t		fracstep;	 
 
+    // the fuzz reads the screen
+    R_FlushColumns ();
+
     // Adjust borders. Low... 
     if (!dc_yl) 
 	dc_yl = 1;
@@ -355,13 +523,13 @@ void R_DrawFuzzColumn (void)
 	//  a pixel that is either one column
 	//  left or right of the current one.
 	// Add index from colormap to index.
-	*dest = colormaps[6*256+dest[fuzzoffset[fuzzpos]]]; 
+	*dest = colormaps[6*256+dest[fuzzoffset[fuzzpos]*rowpitch]]; 
 
 	// Clamp table lookup index.
 	if (++fuzzpos == FUZZTABLE) 
 	    fuzzpos = 0;
 	
-	dest += SCREENWIDTH;
+	dest += rowpitch;
 
 	frac += fracstep; 
     } while (count--); 
@@ -379,7 +547,7 @@ void R_DrawFuzzColumn (void)
 //  of the BaronOfHell, the HellKnight, uses
 //  identical sprites, kinda brightened up.
 //
-byte*	dc_translation;
+RENDERLOCAL byte*	dc_translation;
 byte*	translationtables;
 
 void R_DrawTranslatedColumn (void) 
@@ -440,13 +608,52 @@ void R_DrawTranslatedColumn (void)
 	// Thus the "green" ramp of the player 0 sprite
 	//  is mapped to gray, red, black/indigo. 
 	*dest = dc_colormap[dc_translation[dc_source[frac>>FRACBITS]]];
-	dest += SCREENWIDTH;
+	dest += rowpitch;
 	
 	frac += fracstep; 
     } while (count--); 
 } 
 
 
+//
+// R_QueueTranslatedColumn
+// R_DrawTranslatedColumn into the batch.
+//
+void R_QueueTranslatedColumn (void) 
+{ 
+    int			count; 
+    byte*		dest; 
+    fixed_t		frac;
+    fixed_t		fracstep;	 
+ 
+    count = dc_yh - dc_yl; 
+    if (count < 0) 
+	return; 
+				 
+#ifdef RANGECHECK 
+    if ((unsigned)dc_x >= SCREENWIDTH
+	|| dc_yl < 0
+	|| dc_yh >= SCREENHEIGHT)
+    {
+	I_Error ( "R_QueueTranslatedColumn: %i to %i at %i",
+		  dc_yl, dc_yh, dc_x);
+    }
+#endif 
+
+    dest = R_QueueColumnStart ();
+
+    fracstep = dc_iscale; 
+    frac = dc_texturemid + (dc_yl-centery)*fracstep; 
+
+    do 
+    {
+	*dest = dc_colormap[dc_translation[dc_source[frac>>FRACBITS]]];
+	dest += 4;
+	frac += fracstep; 
+    } while (count--); 
+} 
+
+
 
 
 //
@@ -497,33 +704,44 @@ void R_InitTranslationTables (void)
 // In consequence, flats are not stored by column (like walls),
 //  and the inner loop has to step in texture space u and v.
 //
-int			ds_y; 
-int			ds_x1; 
-int			ds_x2;
+RENDERLOCAL int			ds_y; 
+RENDERLOCAL int			ds_x1; 
+RENDERLOCAL int			ds_x2;
 
-lighttable_t*		ds_colormap; 
+RENDERLOCAL lighttable_t*		ds_colormap; 
 
-fixed_t			ds_xfrac; 
-fixed_t			ds_yfrac; 
-fixed_t			ds_xstep; 
-fixed_t			ds_ystep;
+RENDERLOCAL fixed_t			ds_xfrac; 
+RENDERLOCAL fixed_t			ds_yfrac; 
+RENDERLOCAL fixed_t			ds_xstep; 
+RENDERLOCAL fixed_t			ds_ystep;
 
 // start of a 64*64 tile image 
-byte*			ds_source;	
+RENDERLOCAL byte*			ds_source;	
 
 // just for profiling
-int			dscount;
+RENDERLOCAL int			dscount;
 
 
 //
 // Draws the actual span.
+// u and v are packed into one word, 6.10 bits of u on top and
+//  6.10 bits of v below, so a single add steps both and the spot
+//  is two shifts and a mask away. Four pixels per iteration, each
+//  computed from the start of the group, not from the one before.
+// Without ds_colormap, ds_source is a pre-lit flat (see R_MapPlane)
+//  and the colormap lookup is skipped.
+//
+#define SPANSPOT(pos)	((((pos)>>4)&(63*64)) | ((pos)>>26))
+
 void R_DrawSpan (void) 
 { 
-    fixed_t		xfrac;
-    fixed_t		yfrac; 
+    unsigned		position;
+    unsigned		step;
+    byte*		source;
+    lighttable_t*	colormap;
     byte*		dest; 
+    int			pitch;
     int			count;
-    int			spot; 
 	 
 #ifdef RANGECHECK 
     if (ds_x2 < ds_x1
@@ -537,116 +755,70 @@ void R_DrawSpan (void)
 //	dscount++; 
 #endif 
 
-    
-    xfrac = ds_xfrac; 
-    yfrac = ds_yfrac; 
-	 
-    dest = ylookup[ds_y] + columnofs[ds_x1];
-
-    // We do not check for zero spans here?
-    count = ds_x2 - ds_x1; 
-
-    do 
-    {
-	// Current texture index in u,v.
-	spot = ((yfrac>>(16-6))&(63*64)) + ((xfrac>>16)&63);
-
-	// Lookup pixel from flat texture tile,
-	//  re-index using light/colormap.
-	*dest++ = ds_colormap[ds_source[spot]];
-
-	// Next step in u,v.
-	xfrac += ds_xstep; 
-	yfrac += ds_ystep;
-	
-    } while (count--); 
-} 
-
-
-
-// UNUSED.
-// Loop unrolled by 4.
-#if 0
-void R_DrawSpan (void) 
-{ 
-    unsigned	position, step;
-
-    byte*	source;
-    byte*	colormap;
-    byte*	dest;
-    
-    unsigned	count;
-    usingned	spot; 
-    unsigned	value;
-    unsigned	temp;
-    unsigned	xtemp;
-    unsigned	ytemp;
-		
     position = ((ds_xfrac<<10)&0xffff0000) | ((ds_yfrac>>6)&0xffff);
     step = ((ds_xstep<<10)&0xffff0000) | ((ds_ystep>>6)&0xffff);
-		
+
     source = ds_source;
     colormap = ds_colormap;
-    dest = ylookup[ds_y] + columnofs[ds_x1];	 
+    pitch = colpitch;
+    dest = ylookup[ds_y] + columnofs[ds_x1];
     count = ds_x2 - ds_x1 + 1; 
-	
-    while (count >= 4) 
-    { 
-	ytemp = position>>4;
-	ytemp = ytemp & 4032;
-	xtemp = position>>26;
-	spot = xtemp | ytemp;
-	position += step;
-	dest[0] = colormap[source[spot]]; 
 
-	ytemp = position>>4;
-	ytemp = ytemp & 4032;
-	xtemp = position>>26;
-	spot = xtemp | ytemp;
-	position += step;
-	dest[1] = colormap[source[spot]];
-	
-	ytemp = position>>4;
-	ytemp = ytemp & 4032;
-	xtemp = position>>26;
-	spot = xtemp | ytemp;
-	position += step;
-	dest[2] = colormap[source[spot]];
-	
-	ytemp = position>>4;
-	ytemp = ytemp & 4032;
-	xtemp = position>>26;
-	spot = xtemp | ytemp;
-	position += step;
-	dest[3] = colormap[source[spot]]; 
-		
-	count -= 4;
-	dest += 4;
-    } 
-    while (count > 0) 
-    { 
-	ytemp = position>>4;
-	ytemp = ytemp & 4032;
-	xtemp = position>>26;
-	spot = xtemp | ytemp;
-	position += step;
-	*dest++ = colormap[source[spot]]; 
-	count--;
-    } 
+    if (colormap)
+    {
+	while (count >= 4) 
+	{ 
+	    dest[0] = colormap[source[SPANSPOT(position)]];
+	    dest[pitch] = colormap[source[SPANSPOT(position+step)]];
+	    dest[pitch*2] = colormap[source[SPANSPOT(position+step*2)]];
+	    dest[pitch*3] = colormap[source[SPANSPOT(position+step*3)]];
+	    position += step*4;
+	    dest += pitch*4;
+	    count -= 4;
+	} 
+	while (count--) 
+	{ 
+	    *dest = colormap[source[SPANSPOT(position)]];
+	    position += step;
+	    dest += pitch;
+	} 
+    }
+    else
+    {
+	while (count >= 4) 
+	{ 
+	    dest[0] = source[SPANSPOT(position)];
+	    dest[pitch] = source[SPANSPOT(position+step)];
+	    dest[pitch*2] = source[SPANSPOT(position+step*2)];
+	    dest[pitch*3] = source[SPANSPOT(position+step*3)];
+	    position += step*4;
+	    dest += pitch*4;
+	    count -= 4;
+	} 
+	while (count--) 
+	{ 
+	    *dest = source[SPANSPOT(position)];
+	    position += step;
+	    dest += pitch;
+	} 
+    }
 } 
-#endif
 
 
 //
 // Again..
+// Every texel goes to two pixels side by side.
 //
 void R_DrawSpanLow (void) 
 { 
-    fixed_t		xfrac;
-    fixed_t		yfrac; 
+    unsigned		position;
+    unsigned		step;
+    byte*		source;
+    lighttable_t*	colormap;
     byte*		dest; 
+    int			pitch;
     int			count;
-    int			spot; 
+    byte		c0, c1, c2, c3;
 	 
 #ifdef RANGECHECK 
     if (ds_x2 < ds_x1
@@ -660,29 +832,47 @@ void R_DrawSpanLow (void)
 //	dscount++; 
 #endif 
 	 
-    xfrac = ds_xfrac; 
-    yfrac = ds_yfrac; 
+    position = ((ds_xfrac<<10)&0xffff0000) | ((ds_yfrac>>6)&0xffff);
+    step = ((ds_xstep<<10)&0xffff0000) | ((ds_ystep>>6)&0xffff);
+
+    source = ds_source;
+    colormap = ds_colormap;
+    pitch = colpitch;
 
     // Blocky mode, need to multiply by 2.
-    ds_x1 <<= 1;
-    ds_x2 <<= 1;
-    
-    dest = ylookup[ds_y] + columnofs[ds_x1];
-  
-    
-    count = ds_x2 - ds_x1; 
-    do 
-    { 
-	spot = ((yfrac>>(16-6))&(63*64)) + ((xfrac>>16)&63);
-	// Lowres/blocky mode does it twice,
-	//  while scale is adjusted appropriately.
-	*dest++ = ds_colormap[ds_source[spot]]; 
-	*dest++ = ds_colormap[ds_source[spot]];
-	
-	xfrac += ds_xstep; 
-	yfrac += ds_ystep; 
+    dest = ylookup[ds_y] + columnofs[ds_x1<<1];
+    count = ds_x2 - ds_x1 + 1; 
 
-    } while (count--); 
+    while (count >= 4) 
+    { 
+	c0 = source[SPANSPOT(position)];
+	c1 = source[SPANSPOT(position+step)];
+	c2 = source[SPANSPOT(position+step*2)];
+	c3 = source[SPANSPOT(position+step*3)];
+	if (colormap)
+	{
+	    c0 = colormap[c0];
+	    c1 = colormap[c1];
+	    c2 = colormap[c2];
+	    c3 = colormap[c3];
+	}
+	dest[0] = dest[pitch] = c0;
+	dest[pitch*2] = dest[pitch*3] = c1;
+	dest[pitch*4] = dest[pitch*5] = c2;
+	dest[pitch*6] = dest[pitch*7] = c3;
+	position += step*4;
+	dest += pitch*8;
+	count -= 4;
+    } 
+    while (count--) 
+    { 
+	c0 = source[SPANSPOT(position)];
+	if (colormap)
+	    c0 = colormap[c0];
+	dest[0] = dest[pitch] = c0;
+	position += step;
+	dest += pitch*2;
+    } 
 }
 
 //
@@ -717,6 +907,62 @@ R_InitBuffer
     // Preclaculate all row offsets.
     for (i=0 ; i<height ; i++) 
 	ylookup[i] = screens[0] + (i+viewwindowy)*SCREENWIDTH; 
+
+    rowpitch = SCREENWIDTH;
+    colpitch = 1;
+
+    if (!colmajor)
+	return;
+
+    // Column-major: one column after the other, each height long.
+    if (!viewbuffer)
+	viewbuffer = Z_Malloc (SCREENWIDTH*SCREENHEIGHT, PU_STATIC, NULL);
+
+    for (i=0 ; i<width ; i++) 
+	columnofs[i] = i*height;
+    for (i=0 ; i<height ; i++) 
+	ylookup[i] = viewbuffer + i;
+
+    rowpitch = 1;
+    colpitch = height;
+} 
+
+
+//
+// R_CopyViewBuffer
+// Transposes screen columns x1 to x2 of the column-major
+//  viewbuffer into the view window of screens[0],
+//  eight columns at a time.
+//
+void
+R_CopyViewBuffer
+( int		x1,
+  int		x2 )
+{
+    int		x;
+    int		y;
+    int		i;
+    int		count;
+    byte*	src;
+    byte*	dest;
+
+    for (x=x1 ; x<=x2 ; x+=8)
+    {
+	count = x2-x+1;
+	if (count > 8)
+	    count = 8;
+
+	src = viewbuffer + x*colpitch;
+	dest = screens[0] + viewwindowy*SCREENWIDTH + viewwindowx + x;
+
+	for (y=0 ; y<viewheight ; y++)
+	{
+	    for (i=0 ; i<count ; i++)
+		dest[i] = src[i*colpitch];
+	    src++;
+	    dest += SCREENWIDTH;
+	}
+    }
 } 
  
  
@@ -731,9 +977,12 @@ R_InitBuffer
 void R_FillBackScreen (void) 
 { 
     byte*	src;
-    byte*	dest; 
     int		x;
     int		y; 
+    int		windowx;
+    int		windowy;
+    int		width;
+    int		height;
     patch_t*	patch;
 
     // DOOM border patch.
@@ -744,7 +993,7 @@ void R_FillBackScreen (void)
 
     char*	name;
 	
-    if (scaledviewwidth == 320)
+    if (scaledviewwidth == SCREENWIDTH)
 	return;
 	
     if ( gamemode == commercial)
@@ -753,59 +1002,50 @@ void R_FillBackScreen (void)
 	name = name1;
     
     src = W_CacheLumpName (name, PU_CACHE); 
-    dest = screens[1]; 
-	 
-    for (y=0 ; y<SCREENHEIGHT-SBARHEIGHT ; y++) 
-    { 
-	for (x=0 ; x<SCREENWIDTH/64 ; x++) 
-	{ 
-	    memcpy (dest, src+((y&63)<<6), 64); 
-	    dest += 64; 
-	} 
+    V_FillFlat (1, ORIGHEIGHT-32, src);
 
-	if (SCREENWIDTH&63) 
-	{ 
-	    memcpy (dest, src+((y&63)<<6), SCREENWIDTH&63); 
-	    dest += (SCREENWIDTH&63); 
-	} 
-    } 
+    // the patches are placed in ORIGWIDTH x ORIGHEIGHT coordinates
+    windowx = viewwindowx>>hires;
+    windowy = viewwindowy>>hires;
+    width = scaledviewwidth>>hires;
+    height = viewheight>>hires;
 	
     patch = W_CacheLumpName ("brdr_t",PU_CACHE);
 
-    for (x=0 ; x<scaledviewwidth ; x+=8)
-	V_DrawPatch (viewwindowx+x,viewwindowy-8,1,patch);
+    for (x=0 ; x<width ; x+=8)
+	V_DrawPatch (windowx+x,windowy-8,1,patch);
     patch = W_CacheLumpName ("brdr_b",PU_CACHE);
 
-    for (x=0 ; x<scaledviewwidth ; x+=8)
-	V_DrawPatch (viewwindowx+x,viewwindowy+viewheight,1,patch);
+    for (x=0 ; x<width ; x+=8)
+	V_DrawPatch (windowx+x,windowy+height,1,patch);
     patch = W_CacheLumpName ("brdr_l",PU_CACHE);
 
-    for (y=0 ; y<viewheight ; y+=8)
-	V_DrawPatch (viewwindowx-8,viewwindowy+y,1,patch);
+    for (y=0 ; y<height ; y+=8)
+	V_DrawPatch (windowx-8,windowy+y,1,patch);
     patch = W_CacheLumpName ("brdr_r",PU_CACHE);
 
-    for (y=0 ; y<viewheight ; y+=8)
-	V_DrawPatch (viewwindowx+scaledviewwidth,viewwindowy+y,1,patch);
+    for (y=0 ; y<height ; y+=8)
+	V_DrawPatch (windowx+width,windowy+y,1,patch);
 
 
     // Draw beveled edge. 
-    V_DrawPatch (viewwindowx-8,
-		 viewwindowy-8,
+    V_DrawPatch (windowx-8,
+		 windowy-8,
 		 1,
 		 W_CacheLumpName ("brdr_tl",PU_CACHE));
     
-    V_DrawPatch (viewwindowx+scaledviewwidth,
-		 viewwindowy-8,
+    V_DrawPatch (windowx+width,
+		 windowy-8,
 		 1,
 		 W_CacheLumpName ("brdr_tr",PU_CACHE));
     
-    V_DrawPatch (viewwindowx-8,
-		 viewwindowy+viewheight,
+    V_DrawPatch (windowx-8,
+		 windowy+height,
 		 1,
 		 W_CacheLumpName ("brdr_bl",PU_CACHE));
     
-    V_DrawPatch (viewwindowx+scaledviewwidth,
-		 viewwindowy+viewheight,
+    V_DrawPatch (windowx+width,
+		 windowy+height,
 		 1,
 		 W_CacheLumpName ("brdr_br",PU_CACHE));
 } 
@@ -825,6 +1065,12 @@ R_VideoErase
   //  a 32bit CPU, as GNU GCC/Linux libc did
   //  at one point.
     memcpy (screens[0]+ofs, screens[1]+ofs, count); 
+
+    if (ofs%SCREENWIDTH + count <= SCREENWIDTH)
+	V_MarkRect (ofs%SCREENWIDTH, ofs/SCREENWIDTH, count, 1);
+    else
+	V_MarkRect (0, ofs/SCREENWIDTH, SCREENWIDTH,
+		    (ofs+count-1)/SCREENWIDTH - ofs/SCREENWIDTH + 1);
 } 
 
 
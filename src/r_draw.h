@@ -29,15 +29,15 @@
 #endif
 
 
-extern lighttable_t*	dc_colormap;
-extern int		dc_x;
-extern int		dc_yl;
-extern int		dc_yh;
-extern fixed_t		dc_iscale;
-extern fixed_t		dc_texturemid;
+extern RENDERLOCAL lighttable_t*	dc_colormap;
+extern RENDERLOCAL int		dc_x;
+extern RENDERLOCAL int		dc_yl;
+extern RENDERLOCAL int		dc_yh;
+extern RENDERLOCAL fixed_t		dc_iscale;
+extern RENDERLOCAL fixed_t		dc_texturemid;
 
 // first pixel in a column
-extern byte*		dc_source;		
+extern RENDERLOCAL byte*		dc_source;		
 
 
 // The span blitting interface.
@@ -56,27 +56,35 @@ void 	R_DrawFuzzColumnLow (void);
 void	R_DrawTranslatedColumn (void);
 void	R_DrawTranslatedColumnLow (void);
 
+// Same as R_DrawColumn and R_DrawTranslatedColumn, but batched
+//  four columns at a time; full detail only.
+// R_FlushColumns has to be called before anything else reads
+//  or draws the view, and at the end of the frame.
+void	R_QueueColumn (void);
+void	R_QueueTranslatedColumn (void);
+void	R_FlushColumns (void);
+
 void
 R_VideoErase
 ( unsigned	ofs,
   int		count );
 
-extern int		ds_y;
-extern int		ds_x1;
-extern int		ds_x2;
+extern RENDERLOCAL int		ds_y;
+extern RENDERLOCAL int		ds_x1;
+extern RENDERLOCAL int		ds_x2;
 
-extern lighttable_t*	ds_colormap;
+extern RENDERLOCAL lighttable_t*	ds_colormap;
 
-extern fixed_t		ds_xfrac;
-extern fixed_t		ds_yfrac;
-extern fixed_t		ds_xstep;
-extern fixed_t		ds_ystep;
+extern RENDERLOCAL fixed_t		ds_xfrac;
+extern RENDERLOCAL fixed_t		ds_yfrac;
+extern RENDERLOCAL fixed_t		ds_xstep;
+extern RENDERLOCAL fixed_t		ds_ystep;
 
 // start of a 64*64 tile image
-extern byte*		ds_source;		
+extern RENDERLOCAL byte*		ds_source;		
 
 extern byte*		translationtables;
-extern byte*		dc_translation;
+extern RENDERLOCAL byte*		dc_translation;
 
 
 // Span blitting for rows, floor/ceiling.
@@ -92,6 +100,18 @@ R_InitBuffer
 ( int		width,
   int		height );
 
+// Column-major view buffer (-colmajor), see R_InitBuffer.
+extern boolean		colmajor;
+extern byte*		viewbuffer;
+extern int		rowpitch;
+extern int		colpitch;
+
+// Copies screen columns x1 to x2 of the viewbuffer to screens[0].
+void
+R_CopyViewBuffer
+( int		x1,
+  int		x2 );
+
 
 // Initialize color translation tables,
 //  for player rendering etc.
@@ -28,6 +28,7 @@ static const char rcsid[] = "$Id: r_main.c,v 1.5 1997/02/03 22:45:12 b1 Exp $";
 
 
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
 
@@ -39,6 +40,12 @@ static const char rcsid[] = "$Id: r_main.c,v 1.5 1997/02/03 22:45:12 b1 Exp $";
 
 #include "r_local.h"
 #include "r_sky.h"
+#include "r_arena.h"
+
+#include "m_argv.h"
+#include "m_prof.h"
+#include "w_wad.h"
+#include "sel4_doom.h"
 
 
 
@@ -56,7 +63,7 @@ int			validcount = 1;
 
 
 lighttable_t*		fixedcolormap;
-extern lighttable_t**	walllights;
+extern RENDERLOCAL lighttable_t**	walllights;
 
 int			centerx;
 int			centery;
@@ -100,7 +107,7 @@ int			viewangletox[FINEANGLES/2];
 // The xtoviewangleangle[] table maps a screen pixel
 // to the lowest viewangle that maps back to x ranges
 // from clipangle to -clipangle.
-angle_t			xtoviewangle[SCREENWIDTH+1];
+angle_t			xtoviewangle[MAXSCREENWIDTH+1];
 
 
 // UNUSED.
@@ -122,12 +129,15 @@ int			extralight;
 
 
 
-void (*colfunc) (void);
+RENDERLOCAL void (*colfunc) (void);
 void (*basecolfunc) (void);
 void (*fuzzcolfunc) (void);
 void (*transcolfunc) (void);
 void (*spanfunc) (void);
 
+// -nocolbatch draws every column straight to the screen
+boolean			columnbatch;
+
 
 
 //
@@ -490,13 +500,14 @@ fixed_t R_ScaleFromGlobalAngle (angle_t visangle)
     {
 	scale = FixedDiv (num, den);
 
-	if (scale > 64*FRACUNIT)
-	    scale = 64*FRACUNIT;
+	// the limits are in ORIGWIDTH pixels
+	if (scale > (64<<hires)*FRACUNIT)
+	    scale = (64<<hires)*FRACUNIT;
 	else if (scale < 256)
 	    scale = 256;
     }
     else
-	scale = 64*FRACUNIT;
+	scale = (64<<hires)*FRACUNIT;
 	
     return scale;
 }
@@ -626,7 +637,7 @@ void R_InitLightTables (void)
 	startmap = ((LIGHTLEVELS-1-i)*2)*NUMCOLORMAPS/LIGHTLEVELS;
 	for (j=0 ; j<MAXLIGHTZ ; j++)
 	{
-	    scale = FixedDiv ((SCREENWIDTH/2*FRACUNIT), (j+1)<<LIGHTZSHIFT);
+	    scale = FixedDiv ((ORIGWIDTH/2*FRACUNIT), (j+1)<<LIGHTZSHIFT);
 	    scale >>= LIGHTSCALESHIFT;
 	    level = startmap - scale/DISTMAP;
 	    
@@ -652,6 +663,7 @@ void R_InitLightTables (void)
 boolean		setsizeneeded;
 int		setblocks;
 int		setdetail;
+boolean		setcolmajor;
 
 
 void
@@ -665,6 +677,18 @@ R_SetViewSize
 }
 
 
+//
+// R_SetViewLayout
+// Switches between drawing the view into screens[0] and into the
+//  column-major viewbuffer; takes effect like R_SetViewSize.
+//
+void R_SetViewLayout (boolean columnmajor)
+{
+    setsizeneeded = true;
+    setcolmajor = columnmajor;
+}
+
+
 //
 // R_ExecuteSetViewSize
 //
@@ -686,11 +710,12 @@ void R_ExecuteSetViewSize (void)
     }
     else
     {
-	scaledviewwidth = setblocks*32;
-	viewheight = (setblocks*168/10)&~7;
+	scaledviewwidth = (setblocks*32)<<hires;
+	viewheight = ((setblocks*168/10)&~7)<<hires;
     }
     
     detailshift = setdetail;
+    colmajor = setcolmajor;
     viewwidth = scaledviewwidth>>detailshift;
 	
     centery = viewheight/2;
@@ -699,7 +724,14 @@ void R_ExecuteSetViewSize (void)
     centeryfrac = centery<<FRACBITS;
     projection = centerxfrac;
 
-    if (!detailshift)
+    if (!detailshift && columnbatch && !colmajor)
+    {
+	colfunc = basecolfunc = R_QueueColumn;
+	fuzzcolfunc = R_DrawFuzzColumn;
+	transcolfunc = R_QueueTranslatedColumn;
+	spanfunc = R_DrawSpan;
+    }
+    else if (!detailshift)
     {
 	colfunc = basecolfunc = R_DrawColumn;
 	fuzzcolfunc = R_DrawFuzzColumn;
@@ -718,9 +750,9 @@ void R_ExecuteSetViewSize (void)
 	
     R_InitTextureMapping ();
     
-    // psprite scales
-    pspritescale = FRACUNIT*viewwidth/SCREENWIDTH;
-    pspriteiscale = FRACUNIT*SCREENWIDTH/viewwidth;
+    // psprite scales, the weapon sprites are placed in ORIGWIDTH units
+    pspritescale = FRACUNIT*viewwidth/ORIGWIDTH;
+    pspriteiscale = FRACUNIT*ORIGWIDTH/viewwidth;
     
     // thing clipping
     for (i=0 ; i<viewwidth ; i++)
@@ -742,6 +774,7 @@ void R_ExecuteSetViewSize (void)
     
     // Calculate the light levels to use
     //  for each level / scale combination.
+    // The scales are looked up >>hires, i.e. as if at ORIGWIDTH.
     for (i=0 ; i< LIGHTLEVELS ; i++)
     {
 	startmap = ((LIGHTLEVELS-1-i)*2)*NUMCOLORMAPS/LIGHTLEVELS;
@@ -762,6 +795,10 @@ void R_ExecuteSetViewSize (void)
 
 
 
+#ifdef RENDER_THREADS
+static void R_InitRenderThreads (void);
+#endif
+
 //
 // R_Init
 //
@@ -772,6 +809,11 @@ extern int	screenblocks;
 
 void R_Init (void)
 {
+    columnbatch = !M_CheckParm ("-nocolbatch");
+    litflatson = !M_CheckParm ("-nolitflats");
+    setcolmajor = M_CheckParm ("-colmajor") != 0;
+
+    R_InitFrameArena ();
     R_InitData ();
     printf ("\nR_InitData");
     R_InitPointToAngle ();
@@ -789,6 +831,9 @@ void R_Init (void)
     printf ("\nR_InitSkyMap");
     R_InitTranslationTables ();
     printf ("\nR_InitTranslationsTables");
+#ifdef RENDER_THREADS
+    R_InitRenderThreads ();
+#endif
 	
     framecount = 0;
 }
@@ -850,8 +895,6 @@ void R_SetupFrame (player_t* player)
 	    colormaps
 	    + player->fixedcolormap*256*sizeof(lighttable_t);
 	
-	walllights = scalelightfixed;
-
 	for (i=0 ; i<MAXLIGHTSCALE ; i++)
 	    scalelightfixed[i] = fixedcolormap;
     }
@@ -865,34 +908,250 @@ void R_SetupFrame (player_t* player)
 
 
 //
-// R_RenderView
+// Strip-parallel rendering.
+// With -rthreads N the view is split into N vertical strips
+//  of (nearly) equal width. Every strip runs the whole refresh
+//  (BSP, planes, masked) with its own clip state, clipped to its
+//  columns, on its own thread. The main thread renders strip 0
+//  and waits for the others, so R_RenderPlayerView returns with
+//  the complete view as before.
 //
-void R_RenderPlayerView (player_t* player)
-{	
-    R_SetupFrame (player);
+int			numrenderthreads = 1;
+
+RENDERLOCAL int		renderstrip;
+RENDERLOCAL int		stripx1;
+RENDERLOCAL int		stripx2;
+
+#ifdef RENDER_THREADS
+static void*		stripstart[MAXRENDERTHREADS];
+static void*		stripdone;
+static void*		zonelock;
+#endif
+
+
+//
+// R_LockZone
+// Render threads share the zone; the refresh pools take this
+//  lock around their Z_Malloc and Z_Free calls.
+//
+void R_LockZone (void)
+{
+#ifdef RENDER_THREADS
+    if (numrenderthreads > 1)
+	sel4doom_sem_wait (zonelock);
+#endif
+}
+
+void R_UnlockZone (void)
+{
+#ifdef RENDER_THREADS
+    if (numrenderthreads > 1)
+	sel4doom_sem_post (zonelock);
+#endif
+}
+
+
+//
+// R_SetupStrip
+// Per thread part of the frame setup.
+//
+static void R_SetupStrip (int strip)
+{
+    renderstrip = strip;
+    stripx1 = viewwidth*strip/numrenderthreads;
+    stripx2 = viewwidth*(strip+1)/numrenderthreads - 1;
+
+    colfunc = basecolfunc;
+    if (fixedcolormap)
+	walllights = scalelightfixed;
 
     // Clear buffers.
+    R_ClearFrameArena ();
     R_ClearClipSegs ();
     R_ClearDrawSegs ();
     R_ClearPlanes ();
     R_ClearSprites ();
+}
+
+
+//
+// R_FinishStrip
+// Moves the strip from the column-major viewbuffer to the screen,
+//  and adds its counts to the high water marks; the strips finish
+//  in parallel, so that takes the zone lock.
+//
+static void R_FinishStrip (void)
+{
+    if (colmajor)
+	R_CopyViewBuffer (stripx1<<detailshift,
+			  ((stripx2+1)<<detailshift) - 1);
+
+    R_LockZone ();
+    if (numvisplanes > maxvisplanes)
+	maxvisplanes = numvisplanes;
+    if (vissprite_p - vissprites > maxvissprites)
+	maxvissprites = vissprite_p - vissprites;
+    if (ds_p - drawsegs > maxdrawsegs)
+	maxdrawsegs = ds_p - drawsegs;
+    R_FrameArenaStats ();
+    R_UnlockZone ();
+}
+
+
+#ifdef RENDER_THREADS
+//
+// R_StripThread
+// Renders strip "arg" whenever the main thread starts a frame.
+//
+static void R_StripThread (void* arg)
+{
+    int		strip;
+
+    strip = (intptr_t)arg;
+    for (;;)
+    {
+	sel4doom_sem_wait (stripstart[strip]);
+
+	R_SetupStrip (strip);
+	R_RenderBSPNode (numnodes-1);
+	R_FlushColumns ();
+	R_DrawPlanes ();
+	R_FlushColumns ();
+	R_DrawMasked ();
+	R_FlushColumns ();
+	R_FinishStrip ();
+
+	sel4doom_sem_post (stripdone);
+    }
+}
+
+
+//
+// R_InitRenderThreads
+// Threads need the lumps mapped into memory (see W_AddFile) and
+//  all texture composites built in advance, since neither may go
+//  through the zone while other threads render.
+//
+static void R_InitRenderThreads (void)
+{
+    int		p;
+    int		i;
+
+    p = M_CheckParm ("-rthreads");
+    if (!p || p >= myargc-1)
+	return;
+    numrenderthreads = atoi (myargv[p+1]);
+    if (numrenderthreads < 1)
+	numrenderthreads = 1;
+    if (numrenderthreads > MAXRENDERTHREADS)
+	numrenderthreads = MAXRENDERTHREADS;
+    if (numrenderthreads == 1)
+	return;
+
+    for (i=0 ; i<numlumps ; i++)
+    {
+	if (!lumpinfo[i].data)
+	{
+	    printf ("\nR_InitRenderThreads: %.8s is not in memory, "
+		    "using one strip", lumpinfo[i].name);
+	    numrenderthreads = 1;
+	    return;
+	}
+    }
+
+    R_PrecacheComposites ();
+
+    stripdone = sel4doom_sem_create (0);
+    zonelock = sel4doom_sem_create (1);
+    if (!stripdone || !zonelock)
+    {
+	printf ("\nR_InitRenderThreads: no semaphores, using one strip");
+	numrenderthreads = 1;
+	return;
+    }
+
+    for (i=1 ; i<numrenderthreads ; i++)
+    {
+	stripstart[i] = sel4doom_sem_create (0);
+	if (!stripstart[i]
+	    || sel4doom_thread_create (R_StripThread, (void*)(intptr_t)i))
+	{
+	    printf ("\nR_InitRenderThreads: no thread for strip %i", i);
+	    break;
+	}
+    }
+    numrenderthreads = i;
+    printf ("\nR_InitRenderThreads: %i strips", numrenderthreads);
+}
+#endif
+
+
+//
+// R_RenderView
+//
+void R_RenderPlayerView (player_t* player)
+{	
+#ifdef RENDER_THREADS
+    int		i;
+#endif
+
+    R_SetupFrame (player);
+
+    // The other strips go in parallel.
+#ifdef RENDER_THREADS
+    for (i=1 ; i<numrenderthreads ; i++)
+	sel4doom_sem_post (stripstart[i]);
+#endif
+
+    R_SetupStrip (0);
     
     // check for new console commands.
     NetUpdate ();
 
     // The head node is the last node output.
+    PROF_START (prof_bsp);
     R_RenderBSPNode (numnodes-1);
+    R_FlushColumns ();
+    PROF_STOP (prof_bsp);
     
     // Check for new console commands.
     NetUpdate ();
     
+    PROF_START (prof_planes);
     R_DrawPlanes ();
+    R_FlushColumns ();
+    PROF_STOP (prof_planes);
     
     // Check for new console commands.
     NetUpdate ();
     
+    PROF_START (prof_masked);
     R_DrawMasked ();
+    R_FlushColumns ();
+    PROF_STOP (prof_masked);
+
+    R_FinishStrip ();
+
+    // Wait for the other strips.
+#ifdef RENDER_THREADS
+    for (i=1 ; i<numrenderthreads ; i++)
+	sel4doom_sem_wait (stripdone);
+#endif
 
     // Check for new console commands.
     NetUpdate ();				
 }
+
+
+//
+// R_PrintStats
+// High water marks of the refresh structures and the frame arena
+//  they live in, printed on quit with -renderstats.
+//
+void R_PrintStats (void)
+{
+    printf ("R_PrintStats: visplanes: max %i per frame\n", maxvisplanes);
+    printf ("R_PrintStats: vissprites: max %i per frame\n", maxvissprites);
+    printf ("R_PrintStats: drawsegs: max %i per frame\n", maxdrawsegs);
+    R_PrintFrameArenaStats ();
+}
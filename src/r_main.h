@@ -97,9 +97,10 @@ extern	int		detailshift;
 // Function pointers to switch refresh/drawing functions.
 // Used to select shadow mode etc.
 //
-extern void		(*colfunc) (void);
+extern RENDERLOCAL void	(*colfunc) (void);
 extern void		(*basecolfunc) (void);
 extern void		(*fuzzcolfunc) (void);
+extern void		(*transcolfunc) (void);
 // No shadow effects on floors.
 extern void		(*spanfunc) (void);
 
@@ -164,6 +165,22 @@ void R_Init (void);
 // Called by M_Responder.
 void R_SetViewSize (int blocks, int detail);
 
+// Called by the benchmark to compare view buffer layouts.
+void R_SetViewLayout (boolean columnmajor);
+
+// Called by I_Quit.
+void R_PrintStats (void);
+
+// Strip-parallel rendering, see R_RenderPlayerView.
+extern int		numrenderthreads;
+extern RENDERLOCAL int	renderstrip;	// strip of the calling thread
+extern RENDERLOCAL int	stripx1;	// its first column
+extern RENDERLOCAL int	stripx2;	// its last column
+
+// Held around zone calls made while rendering.
+void R_LockZone (void);
+void R_UnlockZone (void);
+
 #endif
 //-----------------------------------------------------------------------------
 //
@@ -38,6 +38,7 @@ rcsid[] = "$Id: r_plane.c,v 1.4 1997/02/03 16:47:55 b1 Exp $";
 
 #include "r_local.h"
 #include "r_sky.h"
+#include "r_arena.h"
 
 
 
@@ -49,16 +50,27 @@ planefunction_t		ceilingfunc;
 //
 
 // Here comes the obnoxious "visplane".
-#define MAXVISPLANES	128
-visplane_t		visplanes[MAXVISPLANES];
-visplane_t*		lastvisplane;
-visplane_t*		floorplane;
-visplane_t*		ceilingplane;
+// Visplanes are kept in hash chains by height/picnum/lightlevel (heights
+//  are mostly whole units, hence the shift) and
+//  taken from the frame arena, so there is no limit on them.
+#define VISPLANEHASH	128	// power of two
+#define VisplaneHash(height,picnum,lightlevel) \
+	(((unsigned)(picnum)*3 + (unsigned)(lightlevel) + (unsigned)((height)>>FRACBITS)*7) \
+	 & (VISPLANEHASH-1))
 
-// ?
-#define MAXOPENINGS	SCREENWIDTH*64
-short			openings[MAXOPENINGS];
-short*			lastopening;
+static RENDERLOCAL visplane_t*	visplanehash[VISPLANEHASH];
+
+RENDERLOCAL visplane_t*		floorplane;
+RENDERLOCAL visplane_t*		ceilingplane;
+
+RENDERLOCAL int			numvisplanes;	// in use this frame
+int			maxvisplanes;	// high water mark of numvisplanes
+
+// Clip lists of the drawsegs, in chunks from the frame arena;
+//  see R_CheckOpenings.
+#define OPENINGCHUNK	(SCREENWIDTH*16)
+RENDERLOCAL short*			lastopening;
+static RENDERLOCAL short*		openingsend;	// of the chunk
 
 
 //
@@ -66,31 +78,57 @@ short*			lastopening;
 //  floorclip starts out SCREENHEIGHT
 //  ceilingclip starts out -1
 //
-short			floorclip[SCREENWIDTH];
-short			ceilingclip[SCREENWIDTH];
+RENDERLOCAL short			floorclip[MAXSCREENWIDTH];
+RENDERLOCAL short			ceilingclip[MAXSCREENWIDTH];
 
 //
 // spanstart holds the start of a plane span
 // initialized to 0 at start
 //
-int			spanstart[SCREENHEIGHT];
-int			spanstop[SCREENHEIGHT];
+RENDERLOCAL int			spanstart[MAXSCREENHEIGHT];
+RENDERLOCAL int			spanstop[MAXSCREENHEIGHT];
 
 //
 // texture mapping
 //
-lighttable_t**		planezlight;
-fixed_t			planeheight;
+RENDERLOCAL lighttable_t**		planezlight;
+RENDERLOCAL fixed_t			planeheight;
+
+fixed_t			yslope[MAXSCREENHEIGHT];
+fixed_t			distscale[MAXSCREENWIDTH];
+RENDERLOCAL fixed_t			basexscale;
+RENDERLOCAL fixed_t			baseyscale;
+
+RENDERLOCAL fixed_t			cachedheight[MAXSCREENHEIGHT];
+RENDERLOCAL fixed_t			cacheddistance[MAXSCREENHEIGHT];
+RENDERLOCAL fixed_t			cachedxstep[MAXSCREENHEIGHT];
+RENDERLOCAL fixed_t			cachedystep[MAXSCREENHEIGHT];
+
+//
+// Pre-lit flats: a flat run through one colormap, so the span
+//  drawers skip the colormap lookup. Every render thread keeps a
+//  few across frames, hashed by flat and colormap. A slot is built
+//  for a flat and colormap once they drew LITFLATMIN pixels in a
+//  row, i.e. about as many lookups as building it costs.
+//
+#define LITFLATS	16	// power of two
+#define LITFLATMIN	(64*64)
 
-fixed_t			yslope[SCREENHEIGHT];
-fixed_t			distscale[SCREENWIDTH];
-fixed_t			basexscale;
-fixed_t			baseyscale;
+typedef struct
+{
+    int		lump;		// flat and colormap in data,
+    int		map;		//  -1 if none
+    int		wantlump;	// and the ones pixels are counted for
+    int		wantmap;
+    int		pixels;
+    byte	data[64*64];
+} litflat_t;
+
+boolean				litflatson;
+static RENDERLOCAL litflat_t*	litflats;
 
-fixed_t			cachedheight[SCREENHEIGHT];
-fixed_t			cacheddistance[SCREENHEIGHT];
-fixed_t			cachedxstep[SCREENHEIGHT];
-fixed_t			cachedystep[SCREENHEIGHT];
+static RENDERLOCAL int		planelump;
+static RENDERLOCAL byte*	planesource;	// the unlit flat
 
 
 
@@ -104,6 +142,62 @@ void R_InitPlanes (void)
 }
 
 
+//
+// R_CheckOpenings
+// Makes sure there is room for "count" more openings. If the chunk
+//  is full, the rest of it is left unused and a new one is started;
+//  the clip lists already in the old one stay where they are.
+//
+void R_CheckOpenings (int count)
+{
+    int		size;
+
+    if (lastopening && lastopening + count <= openingsend)
+	return;
+
+    size = count > OPENINGCHUNK ? count : OPENINGCHUNK;
+    lastopening = R_FrameAlloc (size*sizeof(*lastopening), fa_openings);
+    openingsend = lastopening + size;
+}
+
+
+//
+// R_LightFlat
+// Switches ds_source to the pre-lit flat for ds_colormap,
+//  if there is one or it is due, and clears ds_colormap.
+//
+static void R_LightFlat (int pixels)
+{
+    litflat_t*	lf;
+    int		map;
+    int		i;
+
+    map = (ds_colormap - colormaps) >> 8;
+    lf = &litflats[(planelump*7 + map) & (LITFLATS-1)];
+
+    if (lf->lump != planelump || lf->map != map)
+    {
+	if (lf->wantlump != planelump || lf->wantmap != map)
+	{
+	    lf->wantlump = planelump;
+	    lf->wantmap = map;
+	    lf->pixels = 0;
+	}
+	lf->pixels += pixels;
+	if (lf->pixels < LITFLATMIN)
+	    return;
+
+	for (i=0 ; i<64*64 ; i++)
+	    lf->data[i] = ds_colormap[planesource[i]];
+	lf->lump = planelump;
+	lf->map = map;
+    }
+
+    ds_source = lf->data;
+    ds_colormap = NULL;
+}
+
+
 //
 // R_MapPlane
 //
@@ -169,6 +263,10 @@ R_MapPlane
 	ds_colormap = planezlight[index];
     }
 	
+    ds_source = planesource;
+    if (litflats)
+	R_LightFlat (x2-x1+1);
+
     ds_y = y;
     ds_x1 = x1;
     ds_x2 = x2;
@@ -194,8 +292,11 @@ void R_ClearPlanes (void)
 	ceilingclip[i] = -1;
     }
 
-    lastvisplane = visplanes;
-    lastopening = openings;
+    // the visplanes went with the frame arena
+    memset (visplanehash, 0, sizeof(visplanehash));
+    numvisplanes = 0;
+
+    lastopening = openingsend = NULL;
     
     // texture calculation
     memset (cachedheight, 0, sizeof(cachedheight));
@@ -211,6 +312,44 @@ void R_ClearPlanes (void)
 
 
 
+//
+// R_NewPlane
+// Allocates a visplane and puts it into its hash chain.
+//
+static visplane_t*
+R_NewPlane
+( fixed_t	height,
+  int		picnum,
+  int		lightlevel )
+{
+    visplane_t*	pl;
+    unsigned	hash;
+
+    pl = R_FrameAlloc (sizeof(*pl) + 2*(SCREENWIDTH+2)*sizeof(*pl->top),
+		       fa_visplanes);
+    pl->top = (unsigned short *)(pl+1) + 1;
+    pl->bottom = pl->top + SCREENWIDTH+2;
+
+    // The arena hands back last frame's memory as it was. An unused
+    //  column must read as top VP_EMPTY over bottom 0, pads included,
+    //  or R_MakeSpans takes it for a span on row VP_EMPTY.
+    memset (pl->top-1, 0xff, (SCREENWIDTH+2)*sizeof(*pl->top));
+    memset (pl->bottom-1, 0, (SCREENWIDTH+2)*sizeof(*pl->bottom));
+
+    numvisplanes++;
+
+    hash = VisplaneHash (height, picnum, lightlevel);
+    pl->next = visplanehash[hash];
+    visplanehash[hash] = pl;
+
+    pl->height = height;
+    pl->picnum = picnum;
+    pl->lightlevel = lightlevel;
+
+    return pl;
+}
+
+
 //
 // R_FindPlane
 //
@@ -228,32 +367,21 @@ R_FindPlane
 	lightlevel = 0;
     }
 	
-    for (check=visplanes; check<lastvisplane; check++)
+    for (check = visplanehash[VisplaneHash (height, picnum, lightlevel)];
+	 check;
+	 check = check->next)
     {
 	if (height == check->height
 	    && picnum == check->picnum
 	    && lightlevel == check->lightlevel)
 	{
-	    break;
+	    return check;
 	}
     }
     
-			
-    if (check < lastvisplane)
-	return check;
-		
-    if (lastvisplane - visplanes == MAXVISPLANES)
-	I_Error ("R_FindPlane: no more visplanes");
-		
-    lastvisplane++;
-
-    check->height = height;
-    check->picnum = picnum;
-    check->lightlevel = lightlevel;
+    check = R_NewPlane (height, picnum, lightlevel);
     check->minx = SCREENWIDTH;
     check->maxx = -1;
-    
-    memset (check->top,0xff,sizeof(check->top));
 		
     return check;
 }
@@ -297,7 +425,7 @@ R_CheckPlane
     }
 
     for (x=intrl ; x<= intrh ; x++)
-	if (pl->top[x] != 0xff)
+	if (pl->top[x] != VP_EMPTY)
 	    break;
 
     if (x > intrh)
@@ -310,15 +438,9 @@ R_CheckPlane
     }
 	
     // make a new visplane
-    lastvisplane->height = pl->height;
-    lastvisplane->picnum = pl->picnum;
-    lastvisplane->lightlevel = pl->lightlevel;
-    
-    pl = lastvisplane++;
+    pl = R_NewPlane (pl->height, pl->picnum, pl->lightlevel);
     pl->minx = start;
     pl->maxx = stop;
-
-    memset (pl->top,0xff,sizeof(pl->top));
 		
     return pl;
 }
@@ -371,22 +493,20 @@ void R_DrawPlanes (void)
     int			x;
     int			stop;
     int			angle;
+    int			i;
 				
-#ifdef RANGECHECK
-    if (ds_p - drawsegs > MAXDRAWSEGS)
-	I_Error ("R_DrawPlanes: drawsegs overflow (%i)",
-		 ds_p - drawsegs);
-    
-    if (lastvisplane - visplanes > MAXVISPLANES)
-	I_Error ("R_DrawPlanes: visplane overflow (%i)",
-		 lastvisplane - visplanes);
-    
-    if (lastopening - openings > MAXOPENINGS)
-	I_Error ("R_DrawPlanes: opening overflow (%i)",
-		 lastopening - openings);
-#endif
+    if (litflatson && !litflats)
+    {
+	R_LockZone ();
+	litflats = Z_Malloc (LITFLATS*sizeof(*litflats), PU_STATIC, NULL);
+	R_UnlockZone ();
+	for (i=0 ; i<LITFLATS ; i++)
+	    litflats[i].lump = litflats[i].wantlump = -1;
+    }
 
-    for (pl = visplanes ; pl < lastvisplane ; pl++)
+    // visplanes don't overlap on screen, so any order will do
+    for (i=0 ; i<VISPLANEHASH ; i++)
+    for (pl = visplanehash[i] ; pl ; pl = pl->next)
     {
 	if (pl->minx > pl->maxx)
 	    continue;
@@ -420,9 +540,8 @@ void R_DrawPlanes (void)
 	}
 	
 	// regular flat
-	ds_source = W_CacheLumpNum(firstflat +
-				   flattranslation[pl->picnum],
-				   PU_STATIC);
+	planelump = firstflat + flattranslation[pl->picnum];
+	planesource = W_CacheLumpNum (planelump, PU_STATIC);
 	
 	planeheight = abs(pl->height-viewz);
 	light = (pl->lightlevel >> LIGHTSEGSHIFT)+extralight;
@@ -435,8 +554,8 @@ void R_DrawPlanes (void)
 
 	planezlight = zlight[light];
 
-	pl->top[pl->maxx+1] = 0xff;
-	pl->top[pl->minx-1] = 0xff;
+	pl->top[pl->maxx+1] = VP_EMPTY;
+	pl->top[pl->minx-1] = VP_EMPTY;
 		
 	stop = pl->maxx + 1;
 
@@ -448,6 +567,6 @@ void R_DrawPlanes (void)
 			pl->bottom[x]);
 	}
 	
-	Z_ChangeTag (ds_source, PU_CACHE);
+	Z_ChangeTag (planesource, PU_CACHE);
     }
 }
@@ -32,7 +32,10 @@
 
 
 // Visplane related.
-extern  short*		lastopening;
+extern RENDERLOCAL short*		lastopening;
+
+extern RENDERLOCAL int		numvisplanes;	// in use this frame
+extern  int		maxvisplanes;	// high water mark of numvisplanes
 
 
 typedef void (*planefunction_t) (int top, int bottom);
@@ -40,14 +43,18 @@ typedef void (*planefunction_t) (int top, int bottom);
 extern planefunction_t	floorfunc;
 extern planefunction_t	ceilingfunc_t;
 
-extern short		floorclip[SCREENWIDTH];
-extern short		ceilingclip[SCREENWIDTH];
+extern RENDERLOCAL short		floorclip[MAXSCREENWIDTH];
+extern RENDERLOCAL short		ceilingclip[MAXSCREENWIDTH];
+
+// Pre-lit flats for the span drawers, off with -nolitflats.
+extern boolean		litflatson;
 
-extern fixed_t		yslope[SCREENHEIGHT];
-extern fixed_t		distscale[SCREENWIDTH];
+extern fixed_t		yslope[MAXSCREENHEIGHT];
+extern fixed_t		distscale[MAXSCREENWIDTH];
 
 void R_InitPlanes (void);
 void R_ClearPlanes (void);
+void R_CheckOpenings (int count);
 
 void
 R_MapPlane
@@ -43,56 +43,56 @@ rcsid[] = "$Id: r_segs.c,v 1.3 1997/01/29 20:10:19 b1 Exp $";
 // OPTIMIZE: closed two sided lines as single sided
 
 // True if any of the segs textures might be visible.
-boolean		segtextured;	
+RENDERLOCAL boolean		segtextured;	
 
 // False if the back side is the same plane.
-boolean		markfloor;	
-boolean		markceiling;
+RENDERLOCAL boolean		markfloor;	
+RENDERLOCAL boolean		markceiling;
 
-boolean		maskedtexture;
-int		toptexture;
-int		bottomtexture;
-int		midtexture;
+RENDERLOCAL boolean		maskedtexture;
+RENDERLOCAL int		toptexture;
+RENDERLOCAL int		bottomtexture;
+RENDERLOCAL int		midtexture;
 
 
-angle_t		rw_normalangle;
+RENDERLOCAL angle_t		rw_normalangle;
 // angle to line origin
-int		rw_angle1;	
+RENDERLOCAL int		rw_angle1;	
 
 //
 // regular wall
 //
-int		rw_x;
-int		rw_stopx;
-angle_t		rw_centerangle;
-fixed_t		rw_offset;
-fixed_t		rw_distance;
-fixed_t		rw_scale;
-fixed_t		rw_scalestep;
-fixed_t		rw_midtexturemid;
-fixed_t		rw_toptexturemid;
-fixed_t		rw_bottomtexturemid;
+RENDERLOCAL int		rw_x;
+RENDERLOCAL int		rw_stopx;
+RENDERLOCAL angle_t		rw_centerangle;
+RENDERLOCAL fixed_t		rw_offset;
+RENDERLOCAL fixed_t		rw_distance;
+RENDERLOCAL fixed_t		rw_scale;
+RENDERLOCAL fixed_t		rw_scalestep;
+RENDERLOCAL fixed_t		rw_midtexturemid;
+RENDERLOCAL fixed_t		rw_toptexturemid;
+RENDERLOCAL fixed_t		rw_bottomtexturemid;
 
-int		worldtop;
-int		worldbottom;
-int		worldhigh;
-int		worldlow;
+RENDERLOCAL int		worldtop;
+RENDERLOCAL int		worldbottom;
+RENDERLOCAL int		worldhigh;
+RENDERLOCAL int		worldlow;
 
-fixed_t		pixhigh;
-fixed_t		pixlow;
-fixed_t		pixhighstep;
-fixed_t		pixlowstep;
+RENDERLOCAL fixed_t		pixhigh;
+RENDERLOCAL fixed_t		pixlow;
+RENDERLOCAL fixed_t		pixhighstep;
+RENDERLOCAL fixed_t		pixlowstep;
 
-fixed_t		topfrac;
-fixed_t		topstep;
+RENDERLOCAL fixed_t		topfrac;
+RENDERLOCAL fixed_t		topstep;
 
-fixed_t		bottomfrac;
-fixed_t		bottomstep;
+RENDERLOCAL fixed_t		bottomfrac;
+RENDERLOCAL fixed_t		bottomstep;
 
 
-lighttable_t**	walllights;
+RENDERLOCAL lighttable_t**	walllights;
 
-short*		maskedtexturecol;
+RENDERLOCAL short*		maskedtexturecol;
 
 
 
@@ -166,7 +166,7 @@ R_RenderMaskedSegRange
 	{
 	    if (!fixedcolormap)
 	    {
-		index = spryscale>>LIGHTSCALESHIFT;
+		index = spryscale>>(LIGHTSCALESHIFT+hires);
 
 		if (index >=  MAXLIGHTSCALE )
 		    index = MAXLIGHTSCALE-1;
@@ -266,7 +266,7 @@ void R_RenderSegLoop (void)
 	    texturecolumn = rw_offset-FixedMul(finetangent[angle],rw_distance);
 	    texturecolumn >>= FRACBITS;
 	    // calculate lighting
-	    index = rw_scale>>LIGHTSCALESHIFT;
+	    index = rw_scale>>(LIGHTSCALESHIFT+hires);
 
 	    if (index >=  MAXLIGHTSCALE )
 		index = MAXLIGHTSCALE-1;
@@ -382,14 +382,15 @@ R_StoreWallRange
     fixed_t		vtop;
     int			lightnum;
 
-    // don't overflow and crash
-    if (ds_p == &drawsegs[MAXDRAWSEGS])
-	return;		
-		
 #ifdef RANGECHECK
     if (start >=viewwidth || start > stop)
 	I_Error ("Bad R_RenderWallRange: %i to %i", start , stop);
 #endif
+
+    // make room for the drawseg and its three clip lists
+    if (ds_p == drawsegs + allocdrawsegs)
+	R_GrowDrawSegs ();
+    R_CheckOpenings (3*(stop-start+1));
     
     sidedef = curline->sidedef;
     linedef = curline->linedef;
@@ -741,6 +742,7 @@ R_StoreWallRange
 	ds_p->silhouette |= SIL_BOTTOM;
 	ds_p->bsilheight = MAXINT;
     }
+    R_IndexDrawSeg (ds_p);
     ds_p++;
 }
 
@@ -112,22 +112,22 @@ extern player_t*	viewplayer;
 extern angle_t		clipangle;
 
 extern int		viewangletox[FINEANGLES/2];
-extern angle_t		xtoviewangle[SCREENWIDTH+1];
+extern angle_t		xtoviewangle[MAXSCREENWIDTH+1];
 //extern fixed_t		finetangent[FINEANGLES/2];
 
-extern fixed_t		rw_distance;
-extern angle_t		rw_normalangle;
+extern RENDERLOCAL fixed_t		rw_distance;
+extern RENDERLOCAL angle_t		rw_normalangle;
 
 
 
 // angle to line origin
-extern int		rw_angle1;
+extern RENDERLOCAL int		rw_angle1;
 
 // Segs count?
 extern int		sscount;
 
-extern visplane_t*	floorplane;
-extern visplane_t*	ceilingplane;
+extern RENDERLOCAL visplane_t*	floorplane;
+extern RENDERLOCAL visplane_t*	ceilingplane;
 
 
 #endif
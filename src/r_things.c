@@ -28,19 +28,24 @@ rcsid[] = "$Id: r_things.c,v 1.5 1997/02/03 16:47:56 b1 Exp $";
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 
 #include "doomdef.h"
 #include "m_swap.h"
+#include "m_argv.h"
 
 #include "i_system.h"
 #include "z_zone.h"
 #include "w_wad.h"
 
 #include "r_local.h"
+#include "r_arena.h"
 
 #include "doomstat.h"
 
+#include "sel4_doom.h"
+
 
 
 #define MINZ				(FRACUNIT*4)
@@ -74,12 +79,12 @@ typedef struct
 fixed_t		pspritescale;
 fixed_t		pspriteiscale;
 
-lighttable_t**	spritelights;
+RENDERLOCAL lighttable_t**	spritelights;
 
 // constant arrays
 //  used for psprite clipping and initializing clipping
-short		negonearray[SCREENWIDTH];
-short		screenheightarray[SCREENWIDTH];
+short		negonearray[MAXSCREENWIDTH];
+short		screenheightarray[MAXSCREENWIDTH];
 
 
 //
@@ -286,9 +291,36 @@ void R_InitSpriteDefs (char** namelist)
 //
 // GAME FUNCTIONS
 //
-vissprite_t	vissprites[MAXVISSPRITES];
-vissprite_t*	vissprite_p;
-int		newvissprite;
+
+// The vissprites of a frame, in the frame arena; the array doubles
+//  in size when it is full, and keeps its size for the next frame.
+RENDERLOCAL vissprite_t*	vissprites;
+RENDERLOCAL vissprite_t*	vissprite_p;
+RENDERLOCAL int		newvissprite;
+
+int		maxvissprites;		// high water mark per frame
+RENDERLOCAL int		allocvissprites;	// size of vissprites[]
+
+
+//
+// R_GrowVisSprites
+//
+static void R_GrowVisSprites (void)
+{
+    vissprite_t*	newsprites;
+    int			newalloc;
+
+    newalloc = allocvissprites*2;
+    newsprites = R_FrameRealloc (vissprites,
+				 allocvissprites*sizeof(*newsprites),
+				 newalloc*sizeof(*newsprites), fa_vissprites);
+
+    vissprite_p = newsprites + (vissprite_p - vissprites);
+    vissprites = newsprites;
+    allocvissprites = newalloc;
+}
+
+void R_SpriteSortBenchmark (void);
 
 
 
@@ -306,6 +338,9 @@ void R_InitSprites (char** namelist)
     }
 	
     R_InitSpriteDefs (namelist);
+
+    if (M_CheckParm ("-spritebench"))
+	R_SpriteSortBenchmark ();
 }
 
 
@@ -316,6 +351,10 @@ void R_InitSprites (char** namelist)
 //
 void R_ClearSprites (void)
 {
+    if (!allocvissprites)
+	allocvissprites = MAXVISSPRITES;
+    vissprites = R_FrameAlloc (allocvissprites*sizeof(*vissprites),
+			       fa_vissprites);
     vissprite_p = vissprites;
 }
 
@@ -323,12 +362,10 @@ void R_ClearSprites (void)
 //
 // R_NewVisSprite
 //
-vissprite_t	overflowsprite;
-
 vissprite_t* R_NewVisSprite (void)
 {
-    if (vissprite_p == &vissprites[MAXVISSPRITES])
-	return &overflowsprite;
+    if (vissprite_p == vissprites + allocvissprites)
+	R_GrowVisSprites ();
     
     vissprite_p++;
     return vissprite_p-1;
@@ -342,11 +379,11 @@ vissprite_t* R_NewVisSprite (void)
 // Masked means: partly transparent, i.e. stored
 //  in posts/runs of opaque pixels.
 //
-short*		mfloorclip;
-short*		mceilingclip;
+RENDERLOCAL short*		mfloorclip;
+RENDERLOCAL short*		mceilingclip;
 
-fixed_t		spryscale;
-fixed_t		sprtopscreen;
+RENDERLOCAL fixed_t		spryscale;
+RENDERLOCAL fixed_t		sprtopscreen;
 
 void R_DrawMaskedColumn (column_t* column)
 {
@@ -416,7 +453,7 @@ R_DrawVisSprite
     }
     else if (vis->mobjflags & MF_TRANSLATION)
     {
-	colfunc = R_DrawTranslatedColumn;
+	colfunc = transcolfunc;
 	dc_translation = translationtables - 256 +
 	    ( (vis->mobjflags & MF_TRANSLATION) >> (MF_TRANSSHIFT-8) );
     }
@@ -536,14 +573,14 @@ void R_ProjectSprite (mobj_t* thing)
     x1 = (centerxfrac + FixedMul (tx,xscale) ) >>FRACBITS;
 
     // off the right side?
-    if (x1 > viewwidth)
+    if (x1 > stripx2)
 	return;
     
     tx +=  spritewidth[lump];
     x2 = ((centerxfrac + FixedMul (tx,xscale) ) >>FRACBITS) - 1;
 
     // off the left side
-    if (x2 < 0)
+    if (x2 < stripx1)
 	return;
     
     // store information in a vissprite
@@ -555,8 +592,8 @@ void R_ProjectSprite (mobj_t* thing)
     vis->gz = thing->z;
     vis->gzt = thing->z + spritetopoffset[lump];
     vis->texturemid = vis->gzt - viewz;
-    vis->x1 = x1 < 0 ? 0 : x1;
-    vis->x2 = x2 >= viewwidth ? viewwidth-1 : x2;	
+    vis->x1 = x1 < stripx1 ? stripx1 : x1;
+    vis->x2 = x2 > stripx2 ? stripx2 : x2;	
     iscale = FixedDiv (FRACUNIT, xscale);
 
     if (flip)
@@ -594,7 +631,7 @@ void R_ProjectSprite (mobj_t* thing)
     else
     {
 	// diminished light
-	index = xscale>>(LIGHTSCALESHIFT-detailshift);
+	index = xscale>>(LIGHTSCALESHIFT-detailshift+hires);
 
 	if (index >= MAXLIGHTSCALE) 
 	    index = MAXLIGHTSCALE-1;
@@ -619,11 +656,11 @@ void R_AddSprites (sector_t* sec)
     // A sector might have been split into several
     //  subsectors during BSP building.
     // Thus we check whether its already added.
-    if (sec->validcount == validcount)
+    if (sec->spritevalid[renderstrip] == validcount)
 	return;		
 
     // Well, now it will be done.
-    sec->validcount = validcount;
+    sec->spritevalid[renderstrip] = validcount;
 	
     lightnum = (sec->lightlevel >> LIGHTSEGSHIFT)+extralight;
 
@@ -679,22 +716,22 @@ void R_DrawPSprite (pspdef_t* psp)
     x1 = (centerxfrac + FixedMul (tx,pspritescale) ) >>FRACBITS;
 
     // off the right side
-    if (x1 > viewwidth)
+    if (x1 > stripx2)
 	return;		
 
     tx +=  spritewidth[lump];
     x2 = ((centerxfrac + FixedMul (tx, pspritescale) ) >>FRACBITS) - 1;
 
     // off the left side
-    if (x2 < 0)
+    if (x2 < stripx1)
 	return;
     
     // store information in a vissprite
     vis = &avis;
     vis->mobjflags = 0;
     vis->texturemid = (BASEYCENTER<<FRACBITS)+FRACUNIT/2-(psp->sy-spritetopoffset[lump]);
-    vis->x1 = x1 < 0 ? 0 : x1;
-    vis->x2 = x2 >= viewwidth ? viewwidth-1 : x2;	
+    vis->x1 = x1 < stripx1 ? stripx1 : x1;
+    vis->x2 = x2 > stripx2 ? stripx2 : x2;	
     vis->scale = pspritescale<<detailshift;
     
     if (flip)
@@ -780,11 +817,86 @@ void R_DrawPlayerSprites (void)
 
 //
 // R_SortVisSprites
+// Links the vissprites into vsprsortedhead by increasing scale,
+//  i.e. back to front. A stable LSD radix sort over the bytes of
+//  scale; sprites of equal scale stay in the order they were
+//  projected in, as with the original selection sort.
 //
-vissprite_t	vsprsortedhead;
+RENDERLOCAL vissprite_t	vsprsortedhead;
 
 
 void R_SortVisSprites (void)
+{
+    int			i;
+    int			count;
+    int			shift;
+    int			digit;
+    int			counts[256];
+    vissprite_t**	src;
+    vissprite_t**	dst;
+    vissprite_t**	swap;
+    vissprite_t*	ds;
+
+    count = vissprite_p - vissprites;
+	
+    vsprsortedhead.next = vsprsortedhead.prev = &vsprsortedhead;
+
+    if (!count)
+	return;
+
+    // two halves of count entries each
+    src = R_FrameAlloc (2*count*sizeof(*src), fa_vissprites);
+    dst = src + count;
+    for (i=0 ; i<count ; i++)
+	src[i] = &vissprites[i];
+
+    // flipping the sign bit makes the unsigned order the signed one
+    for (shift=0 ; shift<32 ; shift+=8)
+    {
+	memset (counts, 0, sizeof(counts));
+	for (i=0 ; i<count ; i++)
+	    counts[(((unsigned)src[i]->scale ^ 0x80000000) >> shift) & 0xff]++;
+
+	// skip the pass if all sprites have the same digit
+	if (counts[(((unsigned)src[0]->scale ^ 0x80000000) >> shift) & 0xff]
+	    == count)
+	    continue;
+
+	// counts become the start of each digit's range
+	for (digit=0, i=0 ; digit<256 ; digit++)
+	{
+	    i += counts[digit];
+	    counts[digit] = i - counts[digit];
+	}
+	
+	for (i=0 ; i<count ; i++)
+	{
+	    digit = (((unsigned)src[i]->scale ^ 0x80000000) >> shift) & 0xff;
+	    dst[counts[digit]++] = src[i];
+	}
+
+	swap = src;
+	src = dst;
+	dst = swap;
+    }
+
+    for (i=0 ; i<count ; i++)
+    {
+	ds = src[i];
+	ds->next = &vsprsortedhead;
+	ds->prev = vsprsortedhead.prev;
+	vsprsortedhead.prev->next = ds;
+	vsprsortedhead.prev = ds;
+    }
+}
+
+
+//
+// R_SelectionSortVisSprites
+// The original sort; quadratic in the number of sprites.
+//  Only kept for R_SpriteSortBenchmark.
+//
+static void R_SelectionSortVisSprites (void)
 {
     int			i;
     int			count;
@@ -797,6 +909,7 @@ void R_SortVisSprites (void)
 	
     unsorted.next = unsorted.prev = &unsorted;
 
+    vsprsortedhead.next = vsprsortedhead.prev = &vsprsortedhead;
     if (!count)
 	return;
 		
@@ -812,8 +925,7 @@ void R_SortVisSprites (void)
     unsorted.prev = vissprite_p-1;
     
     // pull the vissprites out by scale
-    //best = 0;		// shut up the compiler warning
-    vsprsortedhead.next = vsprsortedhead.prev = &vsprsortedhead;
+    best = NULL;
     for (i=0 ; i<count ; i++)
     {
 	bestscale = MAXINT;
@@ -835,6 +947,74 @@ void R_SortVisSprites (void)
 }
 
 
+//
+// R_SpriteSortBenchmark
+// Times both sorts on frames of 64 to 1024 vissprites (a crowd of
+//  monsters in view) and prints the results to the console.
+//  The scales have many duplicates to check that both agree on
+//  the order of equal scales.
+//
+#define SORTBENCH_FRAMES	100
+
+void R_SpriteSortBenchmark (void)
+{
+    int			n;
+    int			i;
+    int			frame;
+    int			mismatch;
+    unsigned		seed;
+    uint64_t		start;
+    uint64_t		selection;
+    uint64_t		radix;
+    vissprite_t*	spr;
+    vissprite_t**	order;
+
+    order = Z_Malloc (1024*sizeof(*order), PU_STATIC, NULL);
+
+    printf ("R_SpriteSortBenchmark: %i frames per test\n", SORTBENCH_FRAMES);
+    for (n=64 ; n<=1024 ; n*=2)
+    {
+	selection = radix = 0;
+	mismatch = 0;
+	seed = n;
+	for (frame=0 ; frame<SORTBENCH_FRAMES ; frame++)
+	{
+	    R_ClearFrameArena ();
+	    R_ClearSprites ();
+	    for (i=0 ; i<n ; i++)
+	    {
+		seed = seed * 1103515245 + 12345;
+		spr = R_NewVisSprite ();
+		spr->scale = (fixed_t)((seed >> 16) % (n/2)) << 10;
+	    }
+
+	    start = sel4doom_get_current_time_ns ();
+	    R_SelectionSortVisSprites ();
+	    selection += sel4doom_get_current_time_ns () - start;
+
+	    for (i=0, spr=vsprsortedhead.next ; i<n ; i++, spr=spr->next)
+		order[i] = spr;
+
+	    start = sel4doom_get_current_time_ns ();
+	    R_SortVisSprites ();
+	    radix += sel4doom_get_current_time_ns () - start;
+
+	    for (i=0, spr=vsprsortedhead.next ; i<n ; i++, spr=spr->next)
+		if (order[i] != spr)
+		    mismatch = 1;
+	}
+	printf ("R_SpriteSortBenchmark: %4i sprites: selection %8u ns"
+		", radix %6u ns per frame%s\n",
+		n,
+		(unsigned)(selection / SORTBENCH_FRAMES),
+		(unsigned)(radix / SORTBENCH_FRAMES),
+		mismatch ? " (ORDER MISMATCH)" : "");
+    }
+
+    Z_Free (order);
+}
+
+
 
 //
 // R_DrawSprite
@@ -842,14 +1022,19 @@ void R_SortVisSprites (void)
 void R_DrawSprite (vissprite_t* spr)
 {
     drawseg_t*		ds;
-    short		clipbot[SCREENWIDTH];
-    short		cliptop[SCREENWIDTH];
+    short		clipbot[MAXSCREENWIDTH];
+    short		cliptop[MAXSCREENWIDTH];
     int			x;
     int			r1;
     int			r2;
     fixed_t		scale;
     fixed_t		lowscale;
     int			silhouette;
+    int			b;
+    int			b1;
+    int			b2;
+    int			next;
+    int			cursor[MAXDSBINS];
 		
     for (x = spr->x1 ; x<=spr->x2 ; x++)
 	clipbot[x] = cliptop[x] = -2;
@@ -857,8 +1042,27 @@ void R_DrawSprite (vissprite_t* spr)
     // Scan drawsegs from end to start for obscuring segs.
     // The first drawseg that has a greater scale
     //  is the clip seg.
-    for (ds=ds_p-1 ; ds >= drawsegs ; ds--)
+    // Only the drawsegs in the bins under the sprite are visited;
+    //  the bins are merged to keep the end to start order, and
+    //  a seg that is in several bins is visited once.
+    b1 = spr->x1 >> DSBINSHIFT;
+    b2 = spr->x2 >> DSBINSHIFT;
+    for (b=b1 ; b<=b2 ; b++)
+	cursor[b] = dsbins[b].numsegs - 1;
+
+    for (;;)
     {
+	next = -1;
+	for (b=b1 ; b<=b2 ; b++)
+	    if (cursor[b] >= 0 && dsbins[b].segs[cursor[b]] > next)
+		next = dsbins[b].segs[cursor[b]];
+	if (next < 0)
+	    break;
+	for (b=b1 ; b<=b2 ; b++)
+	    if (cursor[b] >= 0 && dsbins[b].segs[cursor[b]] == next)
+		cursor[b]--;
+	ds = drawsegs + next;
+
 	// determine if the drawseg obscures the sprite
 	if (ds->x1 > spr->x2
 	    || ds->x2 < spr->x1
@@ -28,22 +28,25 @@
 #pragma interface
 #endif
 
+// initial size of vissprites[], which grows on demand
 #define MAXVISSPRITES  	128
 
-extern vissprite_t	vissprites[MAXVISSPRITES];
-extern vissprite_t*	vissprite_p;
-extern vissprite_t	vsprsortedhead;
+extern RENDERLOCAL vissprite_t*	vissprites;
+extern RENDERLOCAL vissprite_t*	vissprite_p;
+extern int		maxvissprites;		// high water mark per frame
+extern RENDERLOCAL int		allocvissprites;	// size of vissprites[]
+extern RENDERLOCAL vissprite_t	vsprsortedhead;
 
 // Constant arrays used for psprite clipping
 //  and initializing clipping.
-extern short		negonearray[SCREENWIDTH];
-extern short		screenheightarray[SCREENWIDTH];
+extern short		negonearray[MAXSCREENWIDTH];
+extern short		screenheightarray[MAXSCREENWIDTH];
 
 // vars for R_DrawMaskedColumn
-extern short*		mfloorclip;
-extern short*		mceilingclip;
-extern fixed_t		spryscale;
-extern fixed_t		sprtopscreen;
+extern RENDERLOCAL short*		mfloorclip;
+extern RENDERLOCAL short*		mceilingclip;
+extern RENDERLOCAL fixed_t		spryscale;
+extern RENDERLOCAL fixed_t		sprtopscreen;
 
 extern fixed_t		pspritescale;
 extern fixed_t		pspriteiscale;
@@ -13,6 +13,10 @@
 #include <stdint.h>
 #include <sel4/arch/bootinfo.h>
 
+#ifndef UNUSED
+#define UNUSED __attribute__((unused))
+#endif
+
 
 void*
 sel4doom_get_framebuffer_vaddr();
@@ -30,11 +34,43 @@ unsigned int
 sel4doom_get_current_time();
 
 
+/* time since start in ns, from the TSC */
+uint64_t
+sel4doom_get_current_time_ns();
+
+
+/*
+ * Returns a pointer to the content of file "filename" in the boot image (or
+ * NULL if there is no such file); the file size is stored in "size" unless
+ * "size" is NULL.
+ */
 void*
-sel4doom_load_file(const char* filename);
+sel4doom_load_file(const char* filename, unsigned long* size);
 
 
 void
 sel4doom_set_image(int imgId);
 
+
+/*
+ * Threads and semaphores for the strip-parallel renderer (RENDER_THREADS)
+ * and the present thread (-pipeline); the host build only, on seL4 they
+ * always fail. sel4doom_thread_create returns 0 on success,
+ * sel4doom_sem_create returns NULL on failure.
+ */
+int
+sel4doom_thread_create(void (*entry)(void* arg), void* arg);
+
+
+void*
+sel4doom_sem_create(int value);
+
+
+void
+sel4doom_sem_wait(void* sem);
+
+
+void
+sel4doom_sem_post(void* sem);
+
 #endif /* SEL4_DOOM_H_ */
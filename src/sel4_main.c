@@ -11,6 +11,7 @@
 #include <stdio.h>
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 #include <cpio/cpio.h>
 #include <sel4/arch/bootinfo.h>
 #include <allocman/bootstrap.h>
@@ -23,6 +24,7 @@
 #include <sel4utils/vspace.h>
 #include <sel4utils/stack.h>
 #include <simple-stable/simple-stable.h>
+#include <utils/util.h>
 #include "sel4.local/libplatsupport/keyboard_ps2.h"
 #include "sel4.local/libplatsupport/keyboard_chardev.h"
 
@@ -253,6 +255,15 @@ sel4doom_get_current_time() {
 }
 
 
+/*
+ *  @return: time since start (in ns)
+ */
+uint64_t
+sel4doom_get_current_time_ns() {
+    return timer_get_time(tsc_timer->timer);
+}
+
+
 /*
  * @return: base address of frame buffer
  */
@@ -299,9 +310,49 @@ gfx_display_testpic() {
 
 
 void*
-sel4doom_load_file(const char* filename) {
-    UNUSED unsigned long filesize;
-    return cpio_get_file(_cpio_archive, filename, &filesize);
+sel4doom_load_file(const char* filename, unsigned long* size) {
+    unsigned long filesize;
+    /* files are stored without a path in the cpio archive */
+    if (strncmp(filename, "./", 2) == 0) {
+        filename += 2;
+    }
+    void* file = cpio_get_file(_cpio_archive, filename, &filesize);
+    if (file != NULL && size != NULL) {
+        *size = filesize;
+    }
+    return file;
+}
+
+
+/*
+ * The kernel is configured for a single core and the C library has no
+ * thread local storage for additional threads, so there are no threads
+ * here: creating one fails. The strip-parallel renderer needs that thread
+ * local storage, so it is for the host build only.
+ */
+#ifdef RENDER_THREADS
+#error "RENDER_THREADS is for the host build (linux/Makefile) only"
+#endif
+
+int
+sel4doom_thread_create(UNUSED void (*entry)(void* arg), UNUSED void* arg) {
+    return -1;
+}
+
+
+void*
+sel4doom_sem_create(UNUSED int value) {
+    return NULL;
+}
+
+
+void
+sel4doom_sem_wait(UNUSED void* sem) {
+}
+
+
+void
+sel4doom_sem_post(UNUSED void* sem) {
 }
 
 
@@ -454,6 +505,18 @@ readline(char* buf, int buf_len) {
 }
 
 
+/*
+ * Break the command line in "cmdline" into arguments (simply at space chars).
+ */
+static void
+parse_cmdline(int* argc, char* argv[]) {
+    argv[0] = strtok(cmdline," ");
+    for (*argc = 0; argv[*argc] != NULL;) {
+        argv[++(*argc)] = strtok(NULL," ");
+    }
+}
+
+
 /*
  * A command line console. It works nicely for me when running QEMU with
  *  "-serial stdio", but there is probably little real world use for it.
@@ -466,11 +529,8 @@ run_console(int* argc, char* argv[]) {
     for (;;) {
         printf("seL4 > ");
         readline(cmdline, CMDLINE_LEN);
-        /* "parse" command line (simply break at space char) */
-        char* cmd = argv[0] = strtok(cmdline," ");
-        for (*argc = 0; argv[*argc] != NULL;) {
-            argv[++(*argc)] = strtok(NULL," ");
-        }
+        parse_cmdline(argc, argv);
+        char* cmd = argv[0];
         if (cmd == NULL) {
             // empty string; do nothing
         } else if (strcmp(cmd, "ls") == 0) {
@@ -523,6 +583,14 @@ UNUSED static void
     int argc = 1;
     char* argv[CMDLINE_LEN / 2] = {"./doom", NULL};
 
+#ifdef CONFIG_APP_DOOM_CMDLINE
+    /* configured command line, e.g. "-benchmark demo1" for unattended runs */
+    if (CONFIG_APP_DOOM_CMDLINE[0] != '\0') {
+        strncpy(cmdline, "./doom " CONFIG_APP_DOOM_CMDLINE, CMDLINE_LEN - 1);
+        parse_cmdline(&argc, argv);
+    }
+#endif
+
     /* boot into console if 'c' was pressed */
     int c = sel4doom_get_getchar();
     if (c == 'c' || c == 'C') {
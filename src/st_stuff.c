@@ -61,6 +61,7 @@ rcsid[] = "$Id: st_stuff.c,v 1.6 1997/02/03 22:45:13 b1 Exp $";
 #include "dstrings.h"
 #include "sounds.h"
 #include "sel4_doom.h"
+#include "m_prof.h"
 //
 // STATUS BAR DATA
 //
@@ -260,7 +261,7 @@ rcsid[] = "$Id: st_stuff.c,v 1.6 1997/02/03 22:45:13 b1 Exp $";
     (strlen(mapnames[(gameepisode-1)*9+(gamemap-1)]))
 
 #define ST_MAPTITLEX \
-    (SCREENWIDTH - ST_MAPWIDTH * ST_CHATFONTWIDTH)
+    (ORIGWIDTH - ST_MAPWIDTH * ST_CHATFONTWIDTH)
 
 #define ST_MAPTITLEY		0
 #define ST_MAPHEIGHT		1
@@ -476,6 +477,18 @@ unsigned char	cheat_sel4_showlogo1_seq[] =
 };
 
 
+unsigned char	cheat_sel4_profile_seq[] =
+{
+    0x2a, 0x6a, 0xf6, 0x66, 0xff  // prof
+};
+
+
+unsigned char	cheat_sel4_profdump_seq[] =
+{
+    0xe2, 0xea, 0x6e, 0xff  // csv
+};
+
+
 // Now what?
 cheatseq_t	cheat_mus = { cheat_mus_seq, 0 };
 cheatseq_t	cheat_god = { cheat_god_seq, 0 };
@@ -500,6 +513,8 @@ cheatseq_t	cheat_clev = { cheat_clev_seq, 0 };
 cheatseq_t	cheat_mypos = { cheat_mypos_seq, 0 };
 cheatseq_t	cheat_sel4_showlogo0 = { cheat_sel4_showlogo0_seq, 0 };
 cheatseq_t	cheat_sel4_showlogo1 = { cheat_sel4_showlogo1_seq, 0 };
+cheatseq_t	cheat_sel4_profile = { cheat_sel4_profile_seq, 0 };
+cheatseq_t	cheat_sel4_profdump = { cheat_sel4_profdump_seq, 0 };
 // 
 extern char*	mapnames[];
 
@@ -738,6 +753,12 @@ ST_Responder (event_t* ev)
     } else if (cht_CheckCheat(&cheat_sel4_showlogo1, ev->data1))
     {
         sel4doom_set_image(1);
+    } else if (cht_CheckCheat(&cheat_sel4_profile, ev->data1))
+    {
+        M_ProfileToggle();
+    } else if (cht_CheckCheat(&cheat_sel4_profdump, ev->data1))
+    {
+        M_ProfileDump();
     }
   }
   return false;
@@ -1486,5 +1507,6 @@ void ST_Init (void)
 {
     veryfirsttime = 0;
     ST_loadData();
-    screens[4] = (byte *) Z_Malloc(ST_WIDTH*ST_HEIGHT, PU_STATIC, 0);
+    // V_CopyRect uses the screen stride, scaled
+    screens[4] = (byte *) Z_Malloc(SCREENWIDTH*(ST_HEIGHT<<hires), PU_STATIC, 0);
 }
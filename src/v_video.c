@@ -28,6 +28,8 @@ static const char
 rcsid[] = "$Id: v_video.c,v 1.5 1997/02/03 22:45:13 b1 Exp $";
 
 
+#include <stdlib.h>
+
 #include "m_swap.h"
 #include "i_system.h"
 #include "r_local.h"
@@ -36,15 +38,24 @@ rcsid[] = "$Id: v_video.c,v 1.5 1997/02/03 22:45:13 b1 Exp $";
 #include "doomdata.h"
 
 #include "m_bbox.h"
+#include "m_argv.h"
 
 #include "v_video.h"
 
 
 // Each screen is [SCREENWIDTH*SCREENHEIGHT]; 
 byte*				screens[5];	
+
+// The screens are ORIGWIDTH x ORIGHEIGHT scaled by 1<<hires.
+int				hires;
  
 int				dirtybox[4]; 
 
+// Changed columns of screens[0] per row since the last
+//  I_FinishUpdate; a row is clean if dirtyleft > dirtyright.
+short				dirtyleft[MAXSCREENHEIGHT];
+short				dirtyright[MAXSCREENHEIGHT];
+
 
 
 // Now where did these came from?
@@ -146,13 +157,54 @@ V_MarkRect
   int		width,
   int		height ) 
 { 
+    int		x2;
+    int		y2;
+
     M_AddToBox (dirtybox, x, y); 
     M_AddToBox (dirtybox, x+width-1, y+height-1); 
+
+    x2 = x+width-1;
+    y2 = y+height-1;
+    if (x < 0)
+	x = 0;
+    if (x2 >= SCREENWIDTH)
+	x2 = SCREENWIDTH-1;
+    if (y < 0)
+	y = 0;
+    if (y2 >= SCREENHEIGHT)
+	y2 = SCREENHEIGHT-1;
+    if (x > x2)
+	return;
+
+    for ( ; y<=y2 ; y++)
+    {
+	if (x < dirtyleft[y])
+	    dirtyleft[y] = x;
+	if (x2 > dirtyright[y])
+	    dirtyright[y] = x2;
+    }
+} 
+
+
+//
+// V_ClearDirty
+// Called by I_FinishUpdate once the dirty spans are on the screen.
+//
+void V_ClearDirty (void)
+{
+    int		y;
+
+    for (y=0 ; y<SCREENHEIGHT ; y++)
+    {
+	dirtyleft[y] = SCREENWIDTH;
+	dirtyright[y] = -1;
+    }
 } 
  
 
 //
 // V_CopyRect 
+// The rectangle is given in ORIGWIDTH x ORIGHEIGHT coordinates.
 // 
 void
 V_CopyRect
@@ -170,18 +222,25 @@ V_CopyRect
 	 
 #ifdef RANGECHECK 
     if (srcx<0
-	||srcx+width >SCREENWIDTH
+	||srcx+width >ORIGWIDTH
 	|| srcy<0
-	|| srcy+height>SCREENHEIGHT 
-	||destx<0||destx+width >SCREENWIDTH
+	|| srcy+height>ORIGHEIGHT 
+	||destx<0||destx+width >ORIGWIDTH
 	|| desty<0
-	|| desty+height>SCREENHEIGHT 
+	|| desty+height>ORIGHEIGHT 
 	|| (unsigned)srcscrn>4
 	|| (unsigned)destscrn>4)
     {
 	I_Error ("Bad V_CopyRect");
     }
 #endif 
+    srcx <<= hires;
+    srcy <<= hires;
+    destx <<= hires;
+    desty <<= hires;
+    width <<= hires;
+    height <<= hires;
+
     V_MarkRect (destx, desty, width, height); 
 	 
     src = screens[srcscrn]+SCREENWIDTH*srcy+srcx; 
@@ -196,9 +255,60 @@ V_CopyRect
 } 
  
 
+//
+// V_DrawPatchColumn
+// Draws the posts of a patch column at desttop,
+//  every source pixel as a 1<<hires square.
+//
+void
+V_DrawPatchColumn
+( byte*		desttop,
+  column_t*	column )
+{
+    int		count;
+    int		scale;
+    int		i;
+    byte*	dest;
+    byte*	source;
+
+    scale = 1<<hires;
+
+    // step through the posts in a column 
+    while (column->topdelta != 0xff ) 
+    { 
+	source = (byte *)column + 3; 
+	dest = desttop + (column->topdelta<<hires)*SCREENWIDTH; 
+	count = column->length; 
+
+	if (!hires)
+	{
+	    while (count--) 
+	    { 
+		*dest = *source++; 
+		dest += SCREENWIDTH; 
+	    } 
+	}
+	else
+	{
+	    for (count <<= hires ; count-- ; )
+	    {
+		for (i=0 ; i<scale ; i++)
+		    dest[i] = *source;
+		dest += SCREENWIDTH;
+		if (!(count & (scale-1)))
+		    source++;
+	    }
+	}
+	column = (column_t *)(  (byte *)column + column->length 
+				+ 4 ); 
+    } 
+}
+
+
 //
 // V_DrawPatch
 // Masks a column based masked pic to the screen. 
+// x and y are in ORIGWIDTH x ORIGHEIGHT coordinates.
 //
 void
 V_DrawPatch
@@ -208,21 +318,18 @@ V_DrawPatch
   patch_t*	patch ) 
 { 
 
-    int		count;
     int		col; 
     column_t*	column; 
     byte*	desttop;
-    byte*	dest;
-    byte*	source; 
     int		w; 
 	 
     y -= SHORT(patch->topoffset); 
     x -= SHORT(patch->leftoffset); 
 #ifdef RANGECHECK 
     if (x<0
-	||x+SHORT(patch->width) >SCREENWIDTH
+	||x+SHORT(patch->width) >ORIGWIDTH
 	|| y<0
-	|| y+SHORT(patch->height)>SCREENHEIGHT 
+	|| y+SHORT(patch->height)>ORIGHEIGHT 
 	|| (unsigned)scrn>4)
     {
       fprintf( stderr, "Patch at %d,%d exceeds LFB\n", x,y );
@@ -233,32 +340,18 @@ V_DrawPatch
 #endif 
  
     if (!scrn)
-	V_MarkRect (x, y, SHORT(patch->width), SHORT(patch->height)); 
+	V_MarkRect (x<<hires, y<<hires,
+		    SHORT(patch->width)<<hires, SHORT(patch->height)<<hires); 
 
     col = 0; 
-    desttop = screens[scrn]+y*SCREENWIDTH+x; 
+    desttop = screens[scrn]+(y<<hires)*SCREENWIDTH+(x<<hires); 
 	 
     w = SHORT(patch->width); 
 
-    for ( ; col<w ; x++, col++, desttop++)
+    for ( ; col<w ; x++, col++, desttop += 1<<hires)
     { 
 	column = (column_t *)((byte *)patch + LONG(patch->columnofs[col])); 
- 
-	// step through the posts in a column 
-	while (column->topdelta != 0xff ) 
-	{ 
-	    source = (byte *)column + 3; 
-	    dest = desttop + column->topdelta*SCREENWIDTH; 
-	    count = column->length; 
-			 
-	    while (count--) 
-	    { 
-		*dest = *source++; 
-		dest += SCREENWIDTH; 
-	    } 
-	    column = (column_t *)(  (byte *)column + column->length 
-				    + 4 ); 
-	} 
+	V_DrawPatchColumn (desttop, column);
     }			 
 } 
  
@@ -266,6 +359,7 @@ V_DrawPatch
 // V_DrawPatchFlipped 
 // Masks a column based masked pic to the screen.
 // Flips horizontally, e.g. to mirror face.
+// x and y are in ORIGWIDTH x ORIGHEIGHT coordinates.
 //
 void
 V_DrawPatchFlipped
@@ -275,21 +369,18 @@ V_DrawPatchFlipped
   patch_t*	patch ) 
 { 
 
-    int		count;
     int		col; 
     column_t*	column; 
     byte*	desttop;
-    byte*	dest;
-    byte*	source; 
     int		w; 
 	 
     y -= SHORT(patch->topoffset); 
     x -= SHORT(patch->leftoffset); 
 #ifdef RANGECHECK 
     if (x<0
-	||x+SHORT(patch->width) >SCREENWIDTH
+	||x+SHORT(patch->width) >ORIGWIDTH
 	|| y<0
-	|| y+SHORT(patch->height)>SCREENHEIGHT 
+	|| y+SHORT(patch->height)>ORIGHEIGHT 
 	|| (unsigned)scrn>4)
     {
       fprintf( stderr, "Patch origin %d,%d exceeds LFB\n", x,y );
@@ -298,32 +389,18 @@ V_DrawPatchFlipped
 #endif 
  
     if (!scrn)
-	V_MarkRect (x, y, SHORT(patch->width), SHORT(patch->height)); 
+	V_MarkRect (x<<hires, y<<hires,
+		    SHORT(patch->width)<<hires, SHORT(patch->height)<<hires); 
 
     col = 0; 
-    desttop = screens[scrn]+y*SCREENWIDTH+x; 
+    desttop = screens[scrn]+(y<<hires)*SCREENWIDTH+(x<<hires); 
 	 
     w = SHORT(patch->width); 
 
-    for ( ; col<w ; x++, col++, desttop++) 
+    for ( ; col<w ; x++, col++, desttop += 1<<hires)
     { 
 	column = (column_t *)((byte *)patch + LONG(patch->columnofs[w-1-col])); 
- 
-	// step through the posts in a column 
-	while (column->topdelta != 0xff ) 
-	{ 
-	    source = (byte *)column + 3; 
-	    dest = desttop + column->topdelta*SCREENWIDTH; 
-	    count = column->length; 
-			 
-	    while (count--) 
-	    { 
-		*dest = *source++; 
-		dest += SCREENWIDTH; 
-	    } 
-	    column = (column_t *)(  (byte *)column + column->length 
-				    + 4 ); 
-	} 
+	V_DrawPatchColumn (desttop, column);
     }			 
 } 
  
@@ -400,6 +477,7 @@ V_DrawPatchDirect
 //
 // V_DrawBlock
 // Draw a linear block of pixels into the view buffer.
+// Unlike the patches, the block is in screen pixels.
 //
 void
 V_DrawBlock
@@ -476,13 +554,66 @@ V_GetBlock
 
 
 
+//
+// V_FillFlat
+// Tiles the 64x64 flat src over the top "height" rows of screen scrn,
+//  height in ORIGHEIGHT units, scaled like the patches.
+//
+void
+V_FillFlat
+( int		scrn,
+  int		height,
+  byte*		src )
+{
+    int		x;
+    int		y;
+    byte*	dest;
+    byte*	row;
+
+    dest = screens[scrn];
+    height <<= hires;
+
+    for (y=0 ; y<height ; y++)
+    {
+	row = src + (((y>>hires)&63)<<6);
+
+	if (!hires)
+	{
+	    for (x=0 ; x<SCREENWIDTH/64 ; x++)
+	    {
+		memcpy (dest, row, 64);
+		dest += 64;
+	    }
+	    continue;
+	}
+
+	for (x=0 ; x<SCREENWIDTH ; x++)
+	    *dest++ = row[(x>>hires)&63];
+    }
+
+    if (!scrn)
+	V_MarkRect (0, 0, SCREENWIDTH, height);
+}
+
+
 //
 // V_Init
 // 
 void V_Init (void) 
 { 
     int		i;
+    int		p;
     byte*	base;
+
+    // -hires [2|4]: render at 2x or 4x the original resolution
+    p = M_CheckParm ("-hires");
+    if (p)
+    {
+	hires = 1;
+	if (p < myargc-1 && atoi (myargv[p+1]) == 4)
+	    hires = 2;
+    }
+    printf ("V_Init: %ix%i\n", SCREENWIDTH, SCREENHEIGHT);
 		
     // stick these in low dos memory on PCs
 
@@ -490,4 +621,7 @@ void V_Init (void)
 
     for (i=0 ; i<4 ; i++)
 	screens[i] = base + i*SCREENWIDTH*SCREENHEIGHT;
+
+    // nothing is on the screen yet
+    V_MarkRect (0, 0, SCREENWIDTH, SCREENHEIGHT);
 }
@@ -47,6 +47,8 @@
 extern	byte*		screens[5];
 
 extern  int	dirtybox[4];
+extern	short	dirtyleft[MAXSCREENHEIGHT];
+extern	short	dirtyright[MAXSCREENHEIGHT];
 
 extern	byte	gammatable[5][256];
 extern	int	usegamma;
@@ -54,8 +56,15 @@ extern	int	usegamma;
 
 
 // Allocates buffer screens, call before R_Init.
+// Sets hires from -hires.
 void V_Init (void);
 
+//
+// The patch functions and V_CopyRect take ORIGWIDTH x ORIGHEIGHT
+//  coordinates and scale to the screen size, the block functions
+//  and V_MarkRect take screen pixels.
+//
+
 
 void
 V_CopyRect
@@ -83,6 +92,19 @@ V_DrawPatchDirect
   patch_t*	patch );
 
 
+// Tiles a flat over the top height (ORIGHEIGHT units) rows of a screen.
+void
+V_FillFlat
+( int		scrn,
+  int		height,
+  byte*		src );
+
+// Draws one column of a patch, scaled, with its top at desttop.
+void
+V_DrawPatchColumn
+( byte*		desttop,
+  column_t*	column );
+
 // Draw a linear block of pixels into the view buffer.
 void
 V_DrawBlock
@@ -104,6 +126,8 @@ V_GetBlock
   byte*		dest );
 
 
+// Marks a rectangle of screens[0] as changed,
+//  so that I_FinishUpdate copies it to the frame buffer.
 void
 V_MarkRect
 ( int		x,
@@ -111,6 +135,8 @@ V_MarkRect
   int		width,
   int		height );
 
+void V_ClearDirty (void);
+
 #endif
 //-----------------------------------------------------------------------------
 //
@@ -35,6 +35,7 @@ rcsid[] = "$Id: w_wad.c,v 1.5 1997/02/03 16:47:57 b1 Exp $";
 #include "doomtype.h"
 #include "i_system.h"
 #include "z_zone.h"
+#include "sel4_doom.h"
 
 #ifdef __GNUG__
 #pragma implementation "w_wad.h"
@@ -56,6 +57,17 @@ int			numlumps;
 
 void**			lumpcache;
 
+// Name hash: first lump of each chain, chains are linked
+//  through lumpinfo[].next. Later lumps come first in a
+//  chain, so a PWAD still overrides the IWAD.
+static int*		lumphash;
+static unsigned		lumphashmask;
+
+// W_CheckNumForName statistics (see -wadstats)
+static unsigned		lookups;
+static unsigned		lookupprobes;
+static unsigned		lookupmaxprobes;
+
 
 #if defined(linux) || defined(__BEOS__) || defined(__SVR4)
 void strupr (char* s)
@@ -130,6 +142,9 @@ ExtractFileBase
 // If filename starts with a tilde, the file is handled
 //  specially to allow map reloads.
 // But: the reload feature is a fragile hack...
+//
+// Files that are part of the boot image are not read
+//  at all; their lumps are used in place (see W_CacheLumpNum).
 
 #ifdef __BEOS__
 #ifdef __GNUC__
@@ -154,6 +169,8 @@ void W_AddFile (char *filename)
     filelump_t*		fileinfo;
     filelump_t		singleinfo;
     int			storehandle;
+    byte*		base;
+    unsigned long	filesize;
     
     // open the file and add to directory
 
@@ -165,13 +182,17 @@ void W_AddFile (char *filename)
 	reloadlump = numlumps;
     }
 		
-    if ( (handle = fopen (filename,"rb")) == NULL)
+    // reloadable files must be read from disk every time
+    handle = NULL;
+    base = reloadname ? NULL : sel4doom_load_file (filename, &filesize);
+
+    if (!base && (handle = fopen (filename,"rb")) == NULL)
     {
 	printf (" couldn't open %s\n",filename);
 	return;
     }
 
-    printf (" adding %s\n",filename);
+    printf (" adding %s%s\n",filename, base ? " (in memory)" : "");
     startlump = numlumps;
 	
     if (I_strncasecmp (filename+strlen(filename)-3 , "wad", 3 ) )
@@ -179,14 +200,17 @@ void W_AddFile (char *filename)
 	// single lump file
 	fileinfo = &singleinfo;
 	singleinfo.filepos = 0;
-	singleinfo.size = LONG(filelength(handle));
+	singleinfo.size = LONG(base ? (int)filesize : filelength(handle));
 	ExtractFileBase (filename, singleinfo.name);
 	numlumps++;
     }
     else 
     {
 	// WAD file
-	fread (&header, 1, sizeof(header), handle);
+	if (base)
+	    memcpy (&header, base, sizeof(header));
+	else
+	    fread (&header, 1, sizeof(header), handle);
 	if (strncmp(header.identification,"IWAD",4))
 	{
 	    // Homebrew levels?
@@ -201,9 +225,14 @@ void W_AddFile (char *filename)
 	header.numlumps = LONG(header.numlumps);
 	header.infotableofs = LONG(header.infotableofs);
 	length = header.numlumps*sizeof(filelump_t);
-	fileinfo = alloca (length);
-	fseek (handle, header.infotableofs, SEEK_SET);
-	fread (fileinfo, 1, length, handle);
+	if (base)
+	    fileinfo = (filelump_t *)(base + header.infotableofs);
+	else
+	{
+	    fileinfo = alloca (length);
+	    fseek (handle, header.infotableofs, SEEK_SET);
+	    fread (fileinfo, 1, length, handle);
+	}
 	numlumps += header.numlumps;
     }
 
@@ -223,6 +252,7 @@ void W_AddFile (char *filename)
 	lump_p->handle = storehandle;
 	lump_p->position = LONG(fileinfo->filepos);
 	lump_p->size = LONG(fileinfo->size);
+	lump_p->data = base ? base + lump_p->position : NULL;
 	strncpy (lump_p->name, fileinfo->name, 8);
     }
 	
@@ -281,6 +311,91 @@ void W_Reload (void)
 
 
 
+//
+// W_LumpNameHash
+// The name is passed as the two integers used for compares.
+//
+static unsigned W_LumpNameHash (int v1, int v2)
+{
+    unsigned	h;
+
+    h = (unsigned)v1 * 0x9e3779b1u ^ (unsigned)v2;
+    h ^= h >> 15;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    return h & lumphashmask;
+}
+
+
+//
+// W_MarkNamespaces
+// Tags every lump between the sprite and flat
+//  start / end markers with its namespace.
+//
+static void W_MarkNamespaces (void)
+{
+    lumpns_t	ns;
+    int		i;
+    char	name[9];
+
+    ns = ns_global;
+    name[8] = 0;
+
+    for (i=0 ; i<numlumps ; i++)
+    {
+	memcpy (name, lumpinfo[i].name, 8);
+	strupr (name);
+
+	if (!strcmp (name, "S_START") || !strcmp (name, "SS_START"))
+	    ns = ns_sprites;
+	else if (!strcmp (name, "F_START") || !strcmp (name, "FF_START"))
+	    ns = ns_flats;
+	else if (!strcmp (name, "S_END") || !strcmp (name, "SS_END")
+		 || !strcmp (name, "F_END") || !strcmp (name, "FF_END"))
+	{
+	    lumpinfo[i].ns = ns_global;
+	    ns = ns_global;
+	    continue;
+	}
+	lumpinfo[i].ns = ns;
+    }
+}
+
+
+//
+// W_HashLumps
+// Builds the name hash, see W_CheckNumForName.
+//
+static void W_HashLumps (void)
+{
+    unsigned	size;
+    unsigned	h;
+    int		i;
+
+    for (size = 1 ; size < numlumps ; size <<= 1)
+	;
+    lumphashmask = size - 1;
+
+    free (lumphash);
+    lumphash = malloc (size * sizeof(*lumphash));
+    if (!lumphash)
+	I_Error ("Couldn't allocate lumphash");
+
+    for (h=0 ; h<size ; h++)
+	lumphash[h] = -1;
+
+    // insert in file order, so later lumps end up in front
+    for (i=0 ; i<numlumps ; i++)
+    {
+	h = W_LumpNameHash (*(int *)lumpinfo[i].name,
+			    *(int *)&lumpinfo[i].name[4]);
+	lumpinfo[i].next = lumphash[h];
+	lumphash[h] = i;
+    }
+}
+
+
+
 //
 // W_InitMultipleFiles
 // Pass a null terminated list of files to use.
@@ -318,6 +433,9 @@ void W_InitMultipleFiles (char** filenames)
 	I_Error ("Couldn't allocate lumpcache");
 
     memset (lumpcache,0, size);
+
+    W_MarkNamespaces ();
+    W_HashLumps ();
 }
 
 
@@ -349,11 +467,11 @@ int W_NumLumps (void)
 
 
 //
-// W_CheckNumForName
-// Returns -1 if name not found.
+// W_CheckNumForNameNs
+// Returns -1 if name not found in namespace ns.
 //
 
-int W_CheckNumForName (char* name)
+int W_CheckNumForNameNs (char* name, lumpns_t ns)
 {
     union {
 	char	s[9];
@@ -363,6 +481,8 @@ int W_CheckNumForName (char* name)
     
     int		v1;
     int		v2;
+    int		i;
+    unsigned	probes;
     lumpinfo_t*	lump_p;
 
     // make the name into two integers for easy compares
@@ -377,21 +497,57 @@ int W_CheckNumForName (char* name)
     v1 = name8.x[0];
     v2 = name8.x[1];
 
+    lookups++;
+    probes = 0;
 
-    // scan backwards so patch lump files take precedence
-    lump_p = lumpinfo + numlumps;
-
-    while (lump_p-- != lumpinfo)
+    // the chain is in reverse file order,
+    //  so patch lump files take precedence
+    for (i = lumphash[W_LumpNameHash (v1, v2)] ; i != -1 ; i = lump_p->next)
     {
+	lump_p = lumpinfo + i;
+	probes++;
+
 	if ( *(int *)lump_p->name == v1
-	     && *(int *)&lump_p->name[4] == v2)
+	     && *(int *)&lump_p->name[4] == v2
+	     && (ns == ns_global || lump_p->ns == ns))
 	{
-	    return lump_p - lumpinfo;
+	    break;
 	}
     }
 
-    // TFB. Not found.
-    return -1;
+    lookupprobes += probes;
+    if (probes > lookupmaxprobes)
+	lookupmaxprobes = probes;
+
+    // TFB. Not found (i is -1).
+    return i;
+}
+
+
+//
+// W_CheckNumForName
+// Returns -1 if name not found.
+// Searches all namespaces.
+//
+int W_CheckNumForName (char* name)
+{
+    return W_CheckNumForNameNs (name, ns_global);
+}
+
+
+
+
+//
+// W_PrintLookupStats
+//
+void W_PrintLookupStats (void)
+{
+    printf ("W_CheckNumForName: %u lookups, %u probes "
+	    "(avg %u.%02u, max %u), %i lumps in %u buckets\n",
+	    lookups, lookupprobes,
+	    lookups ? lookupprobes / lookups : 0,
+	    lookups ? lookupprobes * 100 / lookups % 100 : 0,
+	    lookupmaxprobes, numlumps, lumphashmask + 1);
 }
 
 
@@ -446,6 +602,12 @@ W_ReadLump
 	I_Error ("W_ReadLump: %i >= numlumps",lump);
 
     l = lumpinfo+lump;
+
+    if (l->data)
+    {
+	memcpy (dest, l->data, l->size);
+	return;
+    }
 	
     // ??? I_BeginRead ();
 	
@@ -486,6 +648,13 @@ W_CacheLumpNum
 
     if ((unsigned)lump >= numlumps)
 	I_Error ("W_CacheLumpNum: %i >= numlumps",lump);
+
+    // Lumps of files in the boot image are handed out in place:
+    //  no copy, no zone memory; Z_ChangeTag and Z_Free leave
+    //  them alone. Such lumps are read-only, so callers that
+    //  modify a lump must use W_CacheLumpNumMutable.
+    if (lumpinfo[lump].data)
+	return lumpinfo[lump].data;
 		
     if (!lumpcache[lump])
     {
@@ -506,6 +675,36 @@ W_CacheLumpNum
 
 
 
+//
+// W_CacheLumpNumMutable
+// Like W_CacheLumpNum, but the caller may modify the
+//  returned data. The tag must not be purgable.
+//
+void*
+W_CacheLumpNumMutable
+( int		lump,
+  int		tag )
+{
+    byte*	ptr;
+
+    if ((unsigned)lump >= numlumps)
+	I_Error ("W_CacheLumpNumMutable: %i >= numlumps",lump);
+
+    if (tag >= PU_PURGELEVEL)
+	I_Error ("W_CacheLumpNumMutable: purgable tag %i",tag);
+
+    // file lumps are read into a zone block anyway
+    if (!lumpinfo[lump].data)
+	return W_CacheLumpNum (lump, tag);
+
+    // copy on write
+    ptr = Z_Malloc (W_LumpLength (lump), tag, NULL);
+    memcpy (ptr, lumpinfo[lump].data, lumpinfo[lump].size);
+    return ptr;
+}
+
+
+
 //
 // W_CacheLumpName
 //
@@ -538,7 +737,11 @@ void W_Profile (void)
     for (i=0 ; i<numlumps ; i++)
     {	
 	ptr = lumpcache[i];
-	if (!ptr)
+	if (lumpinfo[i].data)
+	{
+	    ch = 'M';
+	}
+	else if (!ptr)
 	{
 	    ch = ' ';
 	    continue;
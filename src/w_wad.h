@@ -23,6 +23,8 @@
 #ifndef __W_WAD__
 #define __W_WAD__
 
+#include "doomtype.h"
+
 
 #ifdef __GNUG__
 #pragma interface
@@ -53,12 +55,29 @@ typedef struct
 //
 // WADFILE I/O related stuff.
 //
+//
+// Lump namespaces, from the marker lumps
+//  S_START/S_END (also SS_) and F_START/F_END (also FF_).
+//
+typedef enum
+{
+    ns_global,
+    ns_sprites,
+    ns_flats
+} lumpns_t;
+
 typedef struct
 {
     char	name[8];
     int		handle;
     int		position;
     int		size;
+    // next lump in the same name hash chain, -1 ends the chain
+    int		next;
+    lumpns_t	ns;
+    // Lump data if the file is resident in memory (boot image),
+    //  NULL if the lump has to be read from the file.
+    byte*	data;
 } lumpinfo_t;
 
 
@@ -70,13 +89,16 @@ void    W_InitMultipleFiles (char** filenames);
 void    W_Reload (void);
 
 int	W_CheckNumForName (char* name);
+int	W_CheckNumForNameNs (char* name, lumpns_t ns);
 int	W_GetNumForName (char* name);
+void	W_PrintLookupStats (void);
 
 int	W_LumpLength (int lump);
 void    W_ReadLump (int lump, void *dest);
 
 void*	W_CacheLumpNum (int lump, int tag);
 void*	W_CacheLumpName (char* name, int tag);
+void*	W_CacheLumpNumMutable (int lump, int tag);
 
 
 
@@ -0,0 +1,507 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// $Log:$
+//
+// DESCRIPTION:
+//	Zone Memory Allocation, segregated fit backend.
+//	Built instead of z_zone.c when ZONE_SEGREGATED is defined
+//	(Kconfig: APP_DOOM_ZONE_SEGREGATED).
+//
+//-----------------------------------------------------------------------------
+
+#ifdef ZONE_SEGREGATED
+
+#include "z_zone.h"
+#include "i_system.h"
+#include "doomdef.h"
+
+
+//
+// ZONE MEMORY ALLOCATION
+//
+// As in z_zone.c, there is never any space between memblocks,
+//  and there will never be two contiguous free memblocks.
+// Every block knows its neighbour in memory: the next one
+//  is size bytes behind it, the previous one is prevphys.
+//
+// Free blocks are kept in one list per size class; class k
+//  holds the blocks of 2^k to 2^(k+1)-1 bytes.
+// Blocks in use are kept in one list per tag, least recently
+//  (re)tagged first. Z_FreeTags only visits the lists of the
+//  tags it frees, and Z_Malloc purges the purgable blocks
+//  in least recently used order when it runs out of space.
+//
+// next and prev link a block into its free or tag list.
+//
+
+#define ZONEID	0x1d4a11
+
+#define NUMSIZECLASSES	32
+#define NUMTAGS		(PU_CACHE+1)
+
+
+typedef struct
+{
+    // total bytes malloced, including header
+    int		size;
+
+    // first block and the (always used) end marker
+    memblock_t*	first;
+    memblock_t*	end;
+
+    // free blocks by size class, with a bit per non-empty list
+    memblock_t	freelist[NUMSIZECLASSES];
+    unsigned	freemask;
+
+    // used blocks by tag
+    memblock_t	taglist[NUMTAGS];
+
+} memzone_t;
+
+
+
+memzone_t*	mainzone;
+
+
+#define NEXTBLOCK(b)	((memblock_t *)((byte *)(b) + (b)->size))
+
+
+//
+// List helpers; list heads are empty memblocks
+//  linked to themselves.
+//
+static void Z_ListInit (memblock_t* head)
+{
+    head->next = head->prev = head;
+}
+
+static void Z_ListAdd (memblock_t* head, memblock_t* block)
+{
+    block->next = head;
+    block->prev = head->prev;
+    head->prev->next = block;
+    head->prev = block;
+}
+
+static void Z_ListRemove (memblock_t* block)
+{
+    block->prev->next = block->next;
+    block->next->prev = block->prev;
+}
+
+
+static int Z_SizeClass (int size)
+{
+    return 31 - __builtin_clz ((unsigned)size);
+}
+
+
+static void Z_AddFree (memblock_t* block)
+{
+    int		class = Z_SizeClass (block->size);
+
+    // NULL indicates a free block.
+    block->user = NULL;
+    block->tag = 0;
+    block->id = 0;
+
+    Z_ListAdd (&mainzone->freelist[class], block);
+    mainzone->freemask |= 1u << class;
+}
+
+
+static void Z_RemoveFree (memblock_t* block)
+{
+    int		class = Z_SizeClass (block->size);
+
+    Z_ListRemove (block);
+    if (mainzone->freelist[class].next == &mainzone->freelist[class])
+	mainzone->freemask &= ~(1u << class);
+}
+
+
+//
+// Z_FindFree
+// Returns a free block of at least size bytes, or NULL.
+// Blocks of the size's own class are searched first fit;
+//  any block of a larger class is big enough.
+//
+static memblock_t* Z_FindFree (int size)
+{
+    int		class = Z_SizeClass (size);
+    memblock_t*	head = &mainzone->freelist[class];
+    memblock_t*	block;
+    unsigned	larger;
+
+    for (block = head->next ; block != head ; block = block->next)
+    {
+	if (block->size >= size)
+	    return block;
+    }
+
+    larger = class < NUMSIZECLASSES-1
+	? mainzone->freemask & ~((2u << class) - 1) : 0;
+    if (!larger)
+	return NULL;
+
+    return mainzone->freelist[__builtin_ctz (larger)].next;
+}
+
+
+
+//
+// Z_Init
+//
+void Z_Init (void)
+{
+    memblock_t*	block;
+    int		size;
+    int		i;
+
+    mainzone = (memzone_t *)I_ZoneBase (&size);
+    mainzone->size = size;
+    mainzone->freemask = 0;
+
+    for (i=0 ; i<NUMSIZECLASSES ; i++)
+	Z_ListInit (&mainzone->freelist[i]);
+    for (i=0 ; i<NUMTAGS ; i++)
+	Z_ListInit (&mainzone->taglist[i]);
+
+    // the end marker looks like a used block,
+    //  so nothing ever merges with it
+    mainzone->end = (memblock_t *)
+	( (byte *)mainzone + (size & ~3) - sizeof(memblock_t) );
+    mainzone->end->size = sizeof(memblock_t);
+    mainzone->end->user = (void *)mainzone;
+    mainzone->end->tag = PU_STATIC;
+    mainzone->end->id = ZONEID;
+
+    // set the entire zone to one free block
+    block = mainzone->first =
+	(memblock_t *)( (byte *)mainzone + sizeof(memzone_t) );
+    block->size = (byte *)mainzone->end - (byte *)block;
+    block->prevphys = NULL;
+    mainzone->end->prevphys = block;
+
+    Z_AddFree (block);
+}
+
+
+//
+// Z_IsZoneMemory
+// Lumps of files in the boot image are used in place
+//  (see W_CacheLumpNum); they live outside of the zone.
+//
+int Z_IsZoneMemory (void* ptr)
+{
+    return (byte *)ptr > (byte *)mainzone
+	&& (byte *)ptr < (byte *)mainzone + mainzone->size;
+}
+
+
+//
+// Z_Free
+// Pointers outside of the zone are ignored.
+//
+void Z_Free (void* ptr)
+{
+    memblock_t*		block;
+    memblock_t*		other;
+
+    if (!Z_IsZoneMemory (ptr))
+	return;
+
+    block = (memblock_t *) ( (byte *)ptr - sizeof(memblock_t));
+
+    if (block->id != ZONEID)
+	I_Error ("Z_Free: freed a pointer without ZONEID");
+
+    if (block->user > (void **)0x100)
+    {
+	// smaller values are not pointers
+	// Note: OS-dependend?
+
+	// clear the user's mark
+	*block->user = 0;
+    }
+
+    // take it off its tag list
+    Z_ListRemove (block);
+    block->user = NULL;
+
+    other = NEXTBLOCK (block);
+    if (!other->user)
+    {
+	// merge the next free block onto the end
+	Z_RemoveFree (other);
+	block->size += other->size;
+	NEXTBLOCK (block)->prevphys = block;
+    }
+
+    other = block->prevphys;
+    if (other && !other->user)
+    {
+	// merge with previous free block
+	Z_RemoveFree (other);
+	other->size += block->size;
+	NEXTBLOCK (other)->prevphys = other;
+	block = other;
+    }
+
+    Z_AddFree (block);
+}
+
+
+
+//
+// Z_Malloc
+// You can pass a NULL user if the tag is < PU_PURGELEVEL.
+//
+#define MINFRAGMENT		64
+
+
+void*
+Z_Malloc
+( int		size,
+  int		tag,
+  void*		user )
+{
+    int		extra;
+    int		t;
+    memblock_t* newblock;
+    memblock_t*	base;
+
+    if (tag < 0 || tag >= NUMTAGS)
+	I_Error ("Z_Malloc: bad tag %i", tag);
+
+    size = (size + 3) & ~3;
+
+    // account for size of block header
+    size += sizeof(memblock_t);
+
+    // if nothing fits, throw out purgable blocks,
+    //  least recently used first, until something does
+    while ( (base = Z_FindFree (size)) == NULL)
+    {
+	for (t = PU_PURGELEVEL ; t < NUMTAGS ; t++)
+	    if (mainzone->taglist[t].next != &mainzone->taglist[t])
+		break;
+
+	if (t == NUMTAGS)
+	    I_Error ("Z_Malloc: failed on allocation of %i bytes", size);
+
+	Z_Free ((byte *)mainzone->taglist[t].next + sizeof(memblock_t));
+    }
+
+    Z_RemoveFree (base);
+
+    // found a block big enough
+    extra = base->size - size;
+
+    if (extra >  MINFRAGMENT)
+    {
+	// there will be a free fragment after the allocated block
+	newblock = (memblock_t *) ((byte *)base + size );
+	newblock->size = extra;
+	newblock->prevphys = base;
+	NEXTBLOCK (newblock)->prevphys = newblock;
+	base->size = size;
+
+	Z_AddFree (newblock);
+    }
+
+    if (user)
+    {
+	// mark as an in use block
+	base->user = user;
+	*(void **)user = (void *) ((byte *)base + sizeof(memblock_t));
+    }
+    else
+    {
+	if (tag >= PU_PURGELEVEL)
+	    I_Error ("Z_Malloc: an owner is required for purgable blocks");
+
+	// mark as in use, but unowned
+	base->user = (void *)2;
+    }
+    base->tag = tag;
+    Z_ListAdd (&mainzone->taglist[tag], base);
+
+    base->id = ZONEID;
+
+    return (void *) ((byte *)base + sizeof(memblock_t));
+}
+
+
+
+//
+// Z_FreeTags
+//
+void
+Z_FreeTags
+( int		lowtag,
+  int		hightag )
+{
+    memblock_t*	head;
+    int		tag;
+
+    if (lowtag < 0)
+	lowtag = 0;
+    if (hightag >= NUMTAGS)
+	hightag = NUMTAGS-1;
+
+    for (tag = lowtag ; tag <= hightag ; tag++)
+    {
+	head = &mainzone->taglist[tag];
+	while (head->next != head)
+	    Z_Free ( (byte *)head->next+sizeof(memblock_t));
+    }
+}
+
+
+
+//
+// Z_DumpHeap
+// Note: TFileDumpHeap( stdout ) ?
+//
+void
+Z_DumpHeap
+( int		lowtag,
+  int		hightag )
+{
+    memblock_t*	block;
+
+    printf ("zone size: %i  location: %p\n",
+	    mainzone->size,mainzone);
+
+    printf ("tag range: %i to %i\n",
+	    lowtag, hightag);
+
+    for (block = mainzone->first ; block != mainzone->end ; block = NEXTBLOCK (block))
+    {
+	if (block->tag >= lowtag && block->tag <= hightag)
+	    printf ("block:%p    size:%7i    user:%p    tag:%3i\n",
+		    block, block->size, block->user, block->tag);
+
+	if ( NEXTBLOCK (block)->prevphys != block)
+	    printf ("ERROR: next block doesn't have proper back link\n");
+
+	if (!block->user && !NEXTBLOCK (block)->user)
+	    printf ("ERROR: two consecutive free blocks\n");
+    }
+}
+
+
+//
+// Z_FileDumpHeap
+//
+void Z_FileDumpHeap (FILE* f)
+{
+    memblock_t*	block;
+
+    fprintf (f,"zone size: %i  location: %p\n",mainzone->size,mainzone);
+
+    for (block = mainzone->first ; block != mainzone->end ; block = NEXTBLOCK (block))
+    {
+	fprintf (f,"block:%p    size:%7i    user:%p    tag:%3i\n",
+		 block, block->size, block->user, block->tag);
+
+	if ( NEXTBLOCK (block)->prevphys != block)
+	    fprintf (f,"ERROR: next block doesn't have proper back link\n");
+
+	if (!block->user && !NEXTBLOCK (block)->user)
+	    fprintf (f,"ERROR: two consecutive free blocks\n");
+    }
+}
+
+
+
+//
+// Z_CheckHeap
+//
+void Z_CheckHeap (void)
+{
+    memblock_t*	block;
+
+    for (block = mainzone->first ; block != mainzone->end ; block = NEXTBLOCK (block))
+    {
+	if (block->size < (int)sizeof(memblock_t)
+	    || (byte *)NEXTBLOCK (block) > (byte *)mainzone->end)
+	    I_Error ("Z_CheckHeap: block size does not touch the next block\n");
+
+	if ( NEXTBLOCK (block)->prevphys != block)
+	    I_Error ("Z_CheckHeap: next block doesn't have proper back link\n");
+
+	if (!block->user && !NEXTBLOCK (block)->user)
+	    I_Error ("Z_CheckHeap: two consecutive free blocks\n");
+    }
+}
+
+
+
+
+//
+// Z_ChangeTag
+//
+void
+Z_ChangeTag2
+( void*		ptr,
+  int		tag )
+{
+    memblock_t*	block;
+
+    if (!Z_IsZoneMemory (ptr))
+	return;
+
+    block = (memblock_t *) ( (byte *)ptr - sizeof(memblock_t));
+
+    if (block->id != ZONEID)
+	I_Error ("Z_ChangeTag: freed a pointer without ZONEID");
+
+    if (tag >= PU_PURGELEVEL && (unsigned)block->user < 0x100)
+	I_Error ("Z_ChangeTag: an owner is required for purgable blocks");
+
+    if (tag < 0 || tag >= NUMTAGS)
+	I_Error ("Z_ChangeTag: bad tag %i", tag);
+
+    // (re)tagging counts as a use: move to the end of the list
+    Z_ListRemove (block);
+    block->tag = tag;
+    Z_ListAdd (&mainzone->taglist[tag], block);
+}
+
+
+
+//
+// Z_FreeMemory
+//
+int Z_FreeMemory (void)
+{
+    memblock_t*		block;
+    int			free;
+
+    free = 0;
+
+    for (block = mainzone->first ; block != mainzone->end ; block = NEXTBLOCK (block))
+    {
+	if (!block->user || block->tag >= PU_PURGELEVEL)
+	    free += block->size;
+    }
+    return free;
+}
+
+#endif // ZONE_SEGREGATED
@@ -24,6 +24,9 @@
 static const char
 rcsid[] = "$Id: z_zone.c,v 1.4 1997/02/03 16:47:58 b1 Exp $";
 
+// With ZONE_SEGREGATED, z_segfit.c provides the zone instead.
+#ifndef ZONE_SEGREGATED
+
 #include "z_zone.h"
 #include "i_system.h"
 #include "doomdef.h"
@@ -116,13 +119,29 @@ void Z_Init (void)
 }
 
 
+//
+// Z_IsZoneMemory
+// Lumps of files in the boot image are used in place
+//  (see W_CacheLumpNum); they live outside of the zone.
+//
+int Z_IsZoneMemory (void* ptr)
+{
+    return (byte *)ptr > (byte *)mainzone
+	&& (byte *)ptr < (byte *)mainzone + mainzone->size;
+}
+
+
 //
 // Z_Free
+// Pointers outside of the zone are ignored.
 //
 void Z_Free (void* ptr)
 {
     memblock_t*		block;
     memblock_t*		other;
+
+    if (!Z_IsZoneMemory (ptr))
+	return;
 	
     block = (memblock_t *) ( (byte *)ptr - sizeof(memblock_t));
 
@@ -431,6 +450,9 @@ Z_ChangeTag2
   int		tag )
 {
     memblock_t*	block;
+
+    if (!Z_IsZoneMemory (ptr))
+	return;
 	
     block = (memblock_t *) ( (byte *)ptr - sizeof(memblock_t));
 
@@ -465,3 +487,4 @@ int Z_FreeMemory (void)
     return free;
 }
 
+#endif // !ZONE_SEGREGATED
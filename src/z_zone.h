@@ -53,6 +53,7 @@ void    Z_FileDumpHeap (FILE *f);
 void    Z_CheckHeap (void);
 void    Z_ChangeTag2 (void *ptr, int tag);
 int     Z_FreeMemory (void);
+int     Z_IsZoneMemory (void *ptr);
 
 
 typedef struct memblock_s
@@ -63,6 +64,9 @@ typedef struct memblock_s
     int			id;	// should be ZONEID
     struct memblock_s*	next;
     struct memblock_s*	prev;
+#ifdef ZONE_SEGREGATED
+    struct memblock_s*	prevphys;	// block right before this one in memory
+#endif
 } memblock_t;
 
 //
@@ -71,9 +75,12 @@ typedef struct memblock_s
 //
 #define Z_ChangeTag(p,t) \
 { \
-      if (( (memblock_t *)( (byte *)(p) - sizeof(memblock_t)))->id!=0x1d4a11) \
+      if (Z_IsZoneMemory(p) \
+	  && ( (memblock_t *)( (byte *)(p) - sizeof(memblock_t)))->id!=0x1d4a11) \
+      { \
 	  I_Error("Z_CT at "__FILE__":%i",__LINE__); \
-	  Z_ChangeTag2(p,t); \
+      } \
+      Z_ChangeTag2(p,t); \
 };
 
 